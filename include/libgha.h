@@ -14,6 +14,7 @@ extern "C"
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 typedef struct gha_ctx *gha_ctx_t;
 
@@ -25,37 +26,328 @@ struct gha_info {
 
 /*
  * Create context to perform GHA, size is number of samples provided to analyze.
- * Size must be even
+ * Any non zero size is accepted, a frame of one sample has no frequency
+ * information and gives frequency 0.
+ *
+ * Kernels for the host cpu are selected at the first call, GHA_CPU
+ * environment variable forces "generic" or "avx2" kernels, other values
+ * are ignored with a warning on stderr.
  *
  * Returns null in case of fail.
  *
  */
 gha_ctx_t gha_create_ctx(size_t size);
 
+/*
+ * Set zero padding of the windowed frame used to estimate initial frequency.
+ *
+ * The frame is padded to the next fast FFT size not less than size * oversample,
+ * so oversample 1 just rounds FFT size up and bigger values give finer frequency
+ * grid. Newton refinement is still performed over the original samples,
+ * better initial estimation reduces number of its iterations.
+ * Zero oversample disables padding (default).
+ *
+ * Returns 0 on success, -1 in case of fail (previous setting is kept).
+ *
+ */
+int gha_set_fft_padding(size_t oversample, gha_ctx_t ctx);
+
+/*
+ * Limit analysis to frequencies in [omega_min, omega_max] (radians per sample,
+ * 0 <= omega_min < omega_max <= pi), default is [0, pi].
+ *
+ * The initial bin is searched only within the band and Newton refinement is kept
+ * inside it, so the strongest component of the band is found even if a stronger
+ * one is outside. If omega_max is below pi / 4, the initial frequency is estimated
+ * on the frame low pass filtered and decimated by up to pi / (2 * omega_max)
+ * (decimated frame should have at least 64 samples), so fft and most of Newton
+ * iterations run on fewer samples, the padding set by gha_set_fft_padding is not
+ * used in this case.
+ *
+ * Applies to gha_analyze_one, gha_extract_*, gha_analyze_batch, gha_analyze_interleaved,
+ * gha_analyze_candidates and joint analysis, decimation to single frame analysis only.
+ *
+ * Returns 0 on success, -1 in case of fail (previous setting is kept).
+ *
+ */
+int gha_set_band(FLOAT omega_min, FLOAT omega_max, gha_ctx_t ctx);
+
+/*
+ * Refine the fft peak with a zoomed spectrum before Newton search: the frame is
+ * mixed down by the peak frequency and summed in to 64 blocks, small complex fft
+ * of them gives zoom points per fft bin around the peak. It costs about one pass
+ * over the frame and saves a couple of Newton iterations, so it is worth for long
+ * frames (thousands of samples). Zero zoom disables it (default), it is not used
+ * for frames shorter than 64 samples and when band decimation is active.
+ *
+ * Applies to single frame analysis only.
+ *
+ * Returns 0 on success, -1 in case of fail (previous setting is kept).
+ *
+ */
+int gha_set_zoom(size_t zoom, gha_ctx_t ctx);
+
+/*
+ * Frequency refinement after the fft peak search:
+ *
+ * GHA_REFINE_TIME - Newton search over the frame samples, each iteration is O(n) (default)
+ * GHA_REFINE_SPECTRAL - Newton search over the windowed spectrum interpolated from
+ *  33 fft bins around the peak, each iteration is O(1). Frequency differs from the
+ *  time domain search by less than 1e-4 of fft bin for a clean sine and up to 1e-2
+ *  of bin if there are other components close to it, phase up to 0.03 radian.
+ * GHA_REFINE_SPECTRAL_POLISH - spectral search and one Newton iteration over the
+ *  samples, the result is about the same as for GHA_REFINE_TIME.
+ *
+ * Spectral modes pay off for long frames (thousands of samples). They apply to
+ * single frame analysis when band decimation is not active.
+ *
+ */
+enum gha_refine {
+	GHA_REFINE_TIME = 0,
+	GHA_REFINE_SPECTRAL,
+	GHA_REFINE_SPECTRAL_POLISH
+};
+
+void gha_set_refine(enum gha_refine refine, gha_ctx_t ctx);
+
+/*
+ * Quality preset:
+ *
+ * GHA_QUALITY_FULL - fft peak refined by Newton search and magnitude fitted
+ *  over the samples (default)
+ * GHA_QUALITY_FAST - the result is interpolated from the fft peak bin and its
+ *  neighbours, window corrected magnitude and phase, no passes over the samples
+ *  after fft. Band decimation, zoom and refinement settings are not used.
+ *
+ * Fast estimation of a single sine in noise relative to the full one for frames of
+ * 256 samples and more: frequency within 0.01 bin of unpadded fft, phase within
+ * 0.03 radian, magnitude within 1% for sine and Hann windows without padding (their
+ * main lobe shape is used) and within 2% otherwise (parabola over log magnitude).
+ * The error decreases with frame size. Components closer than a few bins or
+ * near 0 and pi make it bigger. It is 4 - 7 times faster than the full analysis
+ * for single frames and about 2 times for gha_analyze_batch.
+ *
+ */
+enum gha_quality {
+	GHA_QUALITY_FULL = 0,
+	GHA_QUALITY_FAST
+};
+
+void gha_set_quality(enum gha_quality quality, gha_ctx_t ctx);
+
+/*
+ * Fields of gha_info wanted from analysis, mask of GHA_FIELD_* (GHA_FIELDS_ALL
+ * by default). Frequency is always computed. Without GHA_FIELD_MAGNITUDE the sine
+ * synthesis and the magnitude pass over the samples are skipped, it saves 30 - 40%
+ * of the full analysis time. Unwanted fields are set to 0.
+ *
+ * The mask applies to gha_analyze_one*, gha_analyze_from, gha_analyze_batch,
+ * gha_analyze_interleaved and gha_analyze_candidates. Extraction always computes
+ * all fields.
+ *
+ */
+#define GHA_FIELD_FREQUENCY 0x1
+#define GHA_FIELD_PHASE 0x2
+#define GHA_FIELD_MAGNITUDE 0x4
+#define GHA_FIELDS_ALL (GHA_FIELD_FREQUENCY | GHA_FIELD_PHASE | GHA_FIELD_MAGNITUDE)
+
+void gha_set_fields(unsigned fields, gha_ctx_t ctx);
+
+/*
+ * Energy gate: frames with RMS below level have no component, their analysis
+ * is one vectorized pass over the samples instead of fft and Newton search.
+ * Such frame gives GHA_NO_COMPONENT status and zeroed gha_info (for functions
+ * without status too: batch, interleaved, candidates and extraction). 0 turns the gate off
+ * (default).
+ *
+ * Returns 0 on success, -1 for negative level.
+ *
+ */
+#define GHA_NO_COMPONENT 1
+
+int gha_set_energy_gate(FLOAT level, gha_ctx_t ctx);
+
+/*
+ * Analysis window applied to the frame before fft and Newton search, all windows
+ * are symmetric and vanish (or nearly) one sample outside the frame:
+ *
+ * GHA_WINDOW_SINE - default, the narrowest main lobe
+ * GHA_WINDOW_HANN - sidelobes fall off faster
+ * GHA_WINDOW_BLACKMAN_HARRIS - 4 term, sidelobes below -92 dB, wide main lobe
+ * GHA_WINDOW_KAISER - param is beta (0 - 700), higher beta gives lower sidelobes
+ * GHA_WINDOW_DPSS - Slepian window, param is time half bandwidth product NW (0 - size / 2)
+ *
+ * Lower sidelobes make the initial bin search less likely to lock on leakage of
+ * a strong component, wider main lobe needs components to be further apart.
+ * Window tables are computed once per type, param and size and shared by contexts.
+ *
+ * Returns 0 on success, -1 in case of fail (previous setting is kept).
+ *
+ */
+enum gha_window {
+	GHA_WINDOW_SINE = 0,
+	GHA_WINDOW_HANN,
+	GHA_WINDOW_BLACKMAN_HARRIS,
+	GHA_WINDOW_KAISER,
+	GHA_WINDOW_DPSS
+};
+
+int gha_set_window(enum gha_window type, FLOAT param, gha_ctx_t ctx);
+
 /*
  * Free GHA context
  */
 void gha_free_ctx(gha_ctx_t ctx);
 
+/*
+ * Size of fft used to estimate initial frequency: frame size or padded size
+ * (see gha_set_fft_padding), fft bin i is at frequency i * 2 * pi / fft size.
+ */
+size_t gha_get_fft_size(gha_ctx_t ctx);
+
+/*
+ * Finds up to k strongest peaks (local maxima) of the windowed spectrum of pcm
+ * within the band (see gha_set_band) in one pass over the fft bins.
+ *
+ * bins[i] receives fft bin of peak i, magnitude[i] sine magnitude estimated from
+ * the bin (underestimated by up to the window scalloping loss), peaks are sorted
+ * by magnitude. Only peaks with magnitude above threshold are reported.
+ * If mask is not null it has fft size / 2 + 1 entries, bins with non zero mask
+ * are skipped (e.g. bins of already extracted components).
+ *
+ * Returns number of found peaks.
+ *
+ * Complexity: O(n * log(n)),
+ * where n is number of samples to anayze
+ *
+ */
+size_t gha_find_peaks(const FLOAT* pcm, size_t k, FLOAT threshold, const unsigned char* mask,
+	size_t* bins, FLOAT* magnitude, gha_ctx_t ctx);
+
 /*
  * Performs one GHA step for given PCM signal,
  * the result will be writen in to given gha_info structure
  *
+ * Returns 0 or GHA_NO_COMPONENT if the frame is below the energy gate
+ * (see gha_set_energy_gate), info is zeroed then.
+ *
  * Complexity: O(n * log(n)),
  * where n is number of samples to anayze
  *
  */
-void gha_analyze_one(const FLOAT* pcm, struct gha_info* info, gha_ctx_t ctx);
+int gha_analyze_one(const FLOAT* pcm, struct gha_info* info, gha_ctx_t ctx);
+
+/*
+ * Same as gha_analyze_one for integer PCM, samples are converted, scaled
+ * to [-1, 1) and windowed in one pass, so no FLOAT copy of the frame is needed.
+ *
+ * s16, s32 - native endian signed samples, scaled by 2^15 and 2^31
+ * s24 - packed 3 byte little endian signed samples (3 * size bytes), scaled by 2^23
+ * u8 - unsigned samples with 128 offset, scaled by 2^7
+ * ulaw, alaw - G.711 samples, decoded to 16 bit linear and scaled by 2^15
+ *
+ * The result magnitude is in the scaled units, the energy gate is applied to
+ * the scaled samples.
+ *
+ */
+int gha_analyze_one_s16(const int16_t* pcm, struct gha_info* info, gha_ctx_t ctx);
+int gha_analyze_one_s24(const uint8_t* pcm, struct gha_info* info, gha_ctx_t ctx);
+int gha_analyze_one_s32(const int32_t* pcm, struct gha_info* info, gha_ctx_t ctx);
+int gha_analyze_one_u8(const uint8_t* pcm, struct gha_info* info, gha_ctx_t ctx);
+int gha_analyze_one_ulaw(const uint8_t* pcm, struct gha_info* info, gha_ctx_t ctx);
+int gha_analyze_one_alaw(const uint8_t* pcm, struct gha_info* info, gha_ctx_t ctx);
+
+/*
+ * Performs one GHA step for each of count PCM frames,
+ * frame i is given by pcm[i] and its result is written in to info[i].
+ *
+ * All context settings are honoured and the result matches gha_analyze_one for
+ * each frame within rounding: several frames are processed at once using one
+ * SIMD lane per frame (4 or 8 frames depending on instruction set), Newton
+ * frequency search and magnitude estimation always, FFT if its size (frame size
+ * or padded size, see gha_set_fft_padding) is a power of two. The magnitude is
+ * fitted to a sine produced by rotation, it may differ from gha_analyze_one in
+ * the last digits. With decimated band estimation (see gha_set_band), zoom
+ * (gha_set_zoom) or spectral refinement (gha_set_refine) frames are analysed
+ * one by one with exactly the gha_analyze_one result.
+ *
+ * Complexity: O(n * log(n) * count),
+ * where n is number of samples to anayze
+ *
+ */
+void gha_analyze_batch(const FLOAT* const* pcm, struct gha_info* info, size_t count, gha_ctx_t ctx);
+
+/*
+ * Performs one GHA step for each channel of interleaved PCM signal,
+ * sample i of channel c is pcm[i * channels + c], result for channel c
+ * is written in to info[c].
+ *
+ * Equivalent of gha_analyze_batch for deinterleaved channels, but the
+ * samples are read directly from the interleaved buffer. Nothing is done
+ * for 0 channels.
+ *
+ */
+void gha_analyze_interleaved(const FLOAT* pcm, size_t channels, struct gha_info* info, gha_ctx_t ctx);
+
+/*
+ * Refines count candidate frequencies omega[i] (radians per sample) for given
+ * PCM signal without FFT. Windowed spectrum is evaluated (Goertzel) on one bin
+ * grid within two bins around each candidate, Newton search starts from the
+ * interpolated peak, so candidates may be off by up to two bins (2 * pi / n).
+ * Several candidates are refined in parallel using SIMD lanes.
+ * Result for candidate i is written in to info[i].
+ *
+ * If fit is not null fit[i] receives goodness of fit of candidate i: energy of
+ * the fitted sine relative to the frame energy, in [0, 1]. It is computed even
+ * if magnitude or phase is not wanted (see gha_set_fields), 0 for the frame
+ * below the energy gate. Start points and results are kept inside the band
+ * set by gha_set_band.
+ *
+ * Complexity: O(n * count),
+ * where n is number of samples to anayze
+ *
+ */
+void gha_analyze_candidates(const FLOAT* pcm, const FLOAT* omega, size_t count, struct gha_info* info, FLOAT* fit, gha_ctx_t ctx);
+
+/*
+ * Performs one GHA step for complex (I/Q) signal of size samples,
+ * iq holds interleaved pairs: iq[2 * n] is I and iq[2 * n + 1] is Q of sample n.
+ *
+ * The signal is modeled as magnitude * exp(i * (frequency * n + phase)), i.e.
+ * I = magnitude * cos(frequency * n + phase), Q = magnitude * sin(frequency * n + phase),
+ * frequency is in (-pi, pi] so its sign is preserved.
+ * The complex FFT is allocated on first call.
+ *
+ * Returns 0 on success, -1 in case of fail.
+ *
+ * Complexity: O(n * log(n)),
+ * where n is number of samples to anayze
+ *
+ */
+int gha_analyze_one_complex(const FLOAT* iq, struct gha_info* info, gha_ctx_t ctx);
+
+/*
+ * Performs one GHA step for complex signal (see gha_analyze_one_complex)
+ * and extracts analysed component from it. Resuidal callback gets 2 * size
+ * interleaved values.
+ *
+ * Returns 0 on success, -1 in case of fail.
+ *
+ */
+int gha_extract_one_complex(FLOAT* iq, struct gha_info* info, gha_ctx_t ctx);
 
 /*
  * Performs one GHA step and extracts analysed harmonic from given PCM signal
  * the result will be writen in to given gha_info structure
  *
+ * Returns 0 or GHA_NO_COMPONENT if the frame is below the energy gate, pcm is
+ * not changed then.
+ *
  * Complexity: O(n * log(n)),
  * where n is number of samples to anayze
  *
  */
-void gha_extract_one(FLOAT* pcm, struct gha_info* info, gha_ctx_t ctx);
+int gha_extract_one(FLOAT* pcm, struct gha_info* info, gha_ctx_t ctx);
 
 /*
  * Performs k GHA steps and extracts analysed harmonics from given PCM signal.
@@ -71,6 +363,114 @@ void gha_extract_one(FLOAT* pcm, struct gha_info* info, gha_ctx_t ctx);
  */
 void gha_extract_many_simple(FLOAT* pcm, struct gha_info* info, size_t k, gha_ctx_t ctx);
 
+/*
+ * Rules to stop extraction:
+ *
+ * GHA_STOP_SNR - once energy of the extracted components relative to the residual
+ *  energy reaches threshold (dB)
+ * GHA_STOP_DROP - when the next component would remove less than threshold part
+ *  (0 - 1) of the residual energy
+ * GHA_STOP_AIC, GHA_STOP_MDL - when the next component does not decrease Akaike or
+ *  minimum description length information criterion, threshold is not used.
+ *  AIC counts 3 parameters per component. MDL counts 5, because frequency is
+ *  estimated size times more precisely than magnitude and phase and so costs
+ *  3 times longer code. AIC tends to take a few noise components, MDL is
+ *  stricter for long frames.
+ *
+ */
+enum gha_stop {
+	GHA_STOP_SNR = 0,
+	GHA_STOP_DROP,
+	GHA_STOP_AIC,
+	GHA_STOP_MDL
+};
+
+struct gha_stop_criterion {
+	enum gha_stop rule;
+	FLOAT threshold;
+};
+
+/*
+ * Extracts components like gha_extract_many_simple until the stop criterion is
+ * met, max_k components at most. The residual energy is computed once and then
+ * updated analytically after each extraction, so the check is O(1) per component.
+ * For GHA_QUALITY_FAST the update assumes least squares magnitude, so the energy
+ * is approximate.
+ *
+ * Returns number of extracted components, the rest of info (up to max_k) is zeroed.
+ *
+ */
+size_t gha_extract_until(FLOAT* pcm, struct gha_info* info, size_t max_k, const struct gha_stop_criterion* stop, gha_ctx_t ctx);
+
+/*
+ * Joint analysis of channels frames of the same source: the frequency is
+ * common for all channels, only magnitude and phase are different.
+ *
+ * The initial bin is taken from the summed power spectra of the channels and
+ * one Newton search maximizes the summed power at target frequency, so the
+ * frequency search is done once for all channels. The result for channel c is
+ * written in to info[c], frequency is the same for all of them.
+ *
+ * Joint analysis ignores the energy gate, the field mask, the quality, zoom
+ * and refinement settings: all fields are computed by the full Newton search.
+ * Nothing is done for 0 channels, the same applies to gha_extract_*_joint.
+ *
+ * Complexity: O(n * log(n) * channels),
+ * where n is number of samples to anayze
+ *
+ */
+void gha_analyze_joint(const FLOAT* const* pcm, size_t channels, struct gha_info* info, gha_ctx_t ctx);
+
+/*
+ * Performs one joint GHA step (see gha_analyze_joint) and extracts analysed
+ * harmonic from each channel. Resuidal callback is called for each channel.
+ */
+void gha_extract_one_joint(FLOAT* const* pcm, size_t channels, struct gha_info* info, gha_ctx_t ctx);
+
+/*
+ * Performs k joint GHA steps, result of step i for channel c is written
+ * in to info[i * channels + c] (k * channels gha_info structures should be allocated)
+ *
+ * Effectively this function is equivalent of calling gha_extract_one_joint k times
+ *
+ */
+void gha_extract_many_joint(FLOAT* const* pcm, size_t channels, struct gha_info* info, size_t k, gha_ctx_t ctx);
+
+/*
+ * Multirate front end for extraction of many components from frames of size samples.
+ *
+ * The frame is split in to bands octaves by a tree of half band filters, each
+ * level is decimated by 2. Band b (b = 0 is the full rate one) covers frequencies
+ * from 0.4 * pi / 2^b up to 0.8 * pi / 2^(b - 1), the highest band up to pi and the
+ * lowest one from 0, so low components are analysed on 2^b times fewer samples.
+ * The lowest band should have at least 64 samples (about size / 2^(bands - 1)).
+ *
+ * Returns null in case of fail.
+ *
+ */
+typedef struct gha_subband *gha_subband_t;
+
+gha_subband_t gha_create_subband(size_t size, size_t bands);
+
+void gha_free_subband(gha_subband_t sb);
+
+/*
+ * Extracts k components from pcm like gha_extract_many_simple: the strongest
+ * component of all bands is taken at each step, it is removed from its band and
+ * the neighbour ones and only these bands are analysed again. Results are mapped
+ * back to full rate frequency and phase, magnitude is corrected by the filters
+ * response. At the end all components are subtracted from pcm and their magnitudes
+ * and phases are fitted once more over the full rate residual, so the residual is
+ * not bigger than the one of gha_extract_many_simple for well separated components.
+ *
+ * If there is no component left (all bands are silent) the rest of info is zeroed.
+ *
+ * Complexity: O(n * log(n) * bands + k * n / 2^b + k * n)
+ * where n is number of samples to anayze and b is band of a component
+ *
+ */
+void gha_extract_many_subband(FLOAT* pcm, struct gha_info* info, size_t k, gha_subband_t sb);
+
 /*
  * Performs multidimensional optimization of extracted harmonics.
  *
@@ -83,6 +483,61 @@ void gha_extract_many_simple(FLOAT* pcm, struct gha_info* info, size_t k, gha_ct
  */
 int gha_adjust_info(const FLOAT* pcm, struct gha_info* info, size_t k, gha_ctx_t ctx);
 
+/*
+ * Extracts k components like gha_extract_many_simple and adjusts them like
+ * gha_adjust_info in one call, pcm is not modified.
+ *
+ * residual receives pcm without the adjusted components, it must not overlap pcm.
+ * It may be null if the residual is not needed, internal buffer is used then.
+ * The residual callback is called after each extraction and for the final residual.
+ *
+ * Returns 0 on success, -1 if adjustment fails (info holds the last good step).
+ *
+ * Complexity: O(n * log(n) * k + k^2 * n + k^3)
+ *
+ */
+int gha_extract_many_adjusted(const FLOAT* pcm, FLOAT* residual, struct gha_info* info, size_t k, gha_ctx_t ctx);
+
+/*
+ * Extracts k components like gha_extract_many_simple, each new component is
+ * adjusted (as in gha_adjust_info) together with up to neighbours (at most 8)
+ * nearest in frequency of the components extracted before it. At the end every
+ * component is adjusted once more with its nearest neighbours of all k. Unlike
+ * gha_adjust_info the sines are produced by rotation and the iterations stop
+ * once the step is negligible.
+ * pcm holds the residual.
+ *
+ * Components interact mostly with close ones: with 2 - 4 neighbours the residual
+ * is several times smaller than after gha_extract_many_simple, though bigger than
+ * after the global adjustment. It is faster than gha_adjust_info from a few tens
+ * of components on.
+ *
+ * Returns 0 on success, -1 if some of the local adjustments fail (the components
+ * keep the last good step, the residual matches them).
+ *
+ * Complexity: O(n * log(n) * k + k * m^2 * n + k * m^3), m = neighbours + 1
+ *
+ */
+int gha_extract_many_local(FLOAT* pcm, struct gha_info* info, size_t k, size_t neighbours, gha_ctx_t ctx);
+
+/*
+ * Extracts harmonic series of pitched signal: info[h] is harmonic h + 1 of one
+ * fundamental, info[0].frequency is the fundamental. pcm holds the residual.
+ *
+ * The strongest component is taken as a harmonic of the fundamental, its number
+ * is chosen by the spectrum power summed over the k harmonics of each candidate.
+ * Then the fundamental, magnitudes and phases are fitted together by least squares:
+ * 1 + 2 * k parameters instead of 3 * k of gha_adjust_info, all but the fundamental
+ * are linear. Harmonics at and above Nyquist frequency are zeroed.
+ *
+ * Returns 0 on success, -1 if the fit fails (info holds the last good step, the
+ * residual matches it), GHA_NO_COMPONENT if the frame is below the energy gate.
+ *
+ * Complexity: O(n * log(n) + k^2 * n + k^3)
+ *
+ */
+int gha_extract_harmonic(FLOAT* pcm, struct gha_info* info, size_t k, gha_ctx_t ctx);
+
 /*
  * Set callback to perform action on resuidal pcm signal.
  *
@@ -0,0 +1,80 @@
+#ifndef LIBGHA_DTMF_H
+#define LIBGHA_DTMF_H
+
+#include <include/libgha.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+/*
+ * DTMF detector for many 8 kHz telephony channels.
+ *
+ * Each call takes one frame per channel. Frames of a group of channels are
+ * screened at once, one channel per SIMD lane: energy gate and Goertzel power
+ * at 8 DTMF frequencies. Channels with one dominant tone in each group are
+ * refined by GHA (gha_analyze_candidates) and validated by frequency deviation,
+ * twist and part of frame energy explained by the two tones.
+ *
+ * A digit is reported once, after it was valid for at least 25 ms of consecutive
+ * frames, the next one can be reported after the same time without a valid digit.
+ *
+ * The detector is not thread safe, to use several threads create one detector
+ * per thread, each serving own set of channels.
+ */
+
+typedef struct gha_dtmf *gha_dtmf_t;
+
+struct gha_dtmf_event {
+	size_t channel;
+	/* '0' - '9', '*', '#', 'A' - 'D' */
+	char digit;
+	/* index of the channel frame the digit was reported at */
+	size_t frame;
+	/* refined tones */
+	struct gha_info low;
+	struct gha_info high;
+};
+
+/*
+ * Create detector for given number of channels and frame size (samples at 8 kHz),
+ * frame size should be at least 80 samples.
+ *
+ * Returns null in case of fail.
+ *
+ */
+gha_dtmf_t gha_dtmf_create(size_t channels, size_t frame_size);
+
+void gha_dtmf_free(gha_dtmf_t dtmf);
+
+/*
+ * Set allowed twist in dB: normal - high tone stronger than low one (default 4),
+ * reverse - low tone stronger than high one (default 8).
+ */
+void gha_dtmf_set_twist(FLOAT normal, FLOAT reverse, gha_dtmf_t dtmf);
+
+/*
+ * Process next frame of count channels starting from first,
+ * frames[i] is frame of channel first + i. The channels should exist,
+ * first + count <= channels of gha_dtmf_create, otherwise nothing is
+ * processed and 0 is returned.
+ *
+ * Detected digits are written in to events, up to count events.
+ * Returns number of events.
+ *
+ */
+size_t gha_dtmf_process(gha_dtmf_t dtmf, size_t first, size_t count, const FLOAT* const* frames, struct gha_dtmf_event* events);
+
+/*
+ * The same for 16 bit linear and G.711 mu-law frames
+ */
+size_t gha_dtmf_process_s16(gha_dtmf_t dtmf, size_t first, size_t count, const int16_t* const* frames, struct gha_dtmf_event* events);
+
+size_t gha_dtmf_process_ulaw(gha_dtmf_t dtmf, size_t first, size_t count, const uint8_t* const* frames, struct gha_dtmf_event* events);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
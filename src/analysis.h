@@ -0,0 +1,22 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <include/libgha.h>
+
+/*
+ * Steps of single frame analysis for other modules of the library
+ */
+
+/*
+ * Coarse estimation of the strongest component within the band of the context:
+ * peak of the windowed spectrum. Returns magnitude estimated from the peak,
+ * frequency of the peak bin is written in to omega.
+ */
+FLOAT gha_estimate_peak(const FLOAT* pcm, double* omega, gha_ctx_t ctx);
+
+/*
+ * The same as gha_analyze_one, but Newton search starts from given omega
+ */
+void gha_analyze_from(const FLOAT* pcm, double omega, struct gha_info* info, gha_ctx_t ctx);
+
+#endif
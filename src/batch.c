@@ -0,0 +1,254 @@
+#include "batch.h"
+#include "simd.h"
+
+#include <string.h>
+#include <math.h>
+
+size_t batch_lanes(void)
+{
+	return VR_LANES;
+}
+
+/*
+ * Returns not zero if lanes of each sample are adjacent in memory,
+ * e.g. interleaved channels
+ */
+static int batch_adjacent(const FLOAT* const* pcm, size_t count)
+{
+	size_t l;
+
+	if (count != VR_LANES)
+		return 0;
+
+	for (l = 1; l < count; l++)
+		if (pcm[l] != pcm[0] + l)
+			return 0;
+
+	return 1;
+}
+
+void batch_window(const FLOAT* const* pcm, size_t stride, size_t count, const FLOAT* window, size_t size, size_t padded_size, FLOAT* out, FLOAT* raw)
+{
+	size_t i, l;
+
+	if (batch_adjacent(pcm, count)) {
+		for (i = 0; i < size; i++) {
+			const vr_t x = vr_load(pcm[0] + i * stride);
+			vr_store(raw + i * VR_LANES, x);
+			vr_store(out + i * VR_LANES, vr_mul(x, vr_set1(window[i])));
+		}
+		memset(out + size * VR_LANES, 0, sizeof(FLOAT) * (padded_size - size) * VR_LANES);
+		return;
+	}
+
+	for (i = 0; i < size; i++) {
+		const FLOAT w = window[i];
+		for (l = 0; l < count; l++) {
+			raw[i * VR_LANES + l] = pcm[l][i * stride];
+			out[i * VR_LANES + l] = pcm[l][i * stride] * w;
+		}
+		for (; l < VR_LANES; l++) {
+			raw[i * VR_LANES + l] = 0;
+			out[i * VR_LANES + l] = 0;
+		}
+	}
+
+	memset(out + size * VR_LANES, 0, sizeof(FLOAT) * (padded_size - size) * VR_LANES);
+}
+
+void batch_argmax(const FLOAT* re, const FLOAT* im, size_t bins, size_t* out)
+{
+	size_t k, l;
+	FLOAT idx[VR_LANES];
+	vr_t max = vr_zero();
+	vr_t max_idx = vr_zero();
+
+	for (k = 0; k < bins; k++) {
+		const vr_t r = vr_load(re + k * VR_LANES);
+		const vr_t i = vr_load(im + k * VR_LANES);
+		const vr_t p = vr_add(vr_mul(r, r), vr_mul(i, i));
+		const vr_t gt = vr_gt(p, max);
+		max = vr_select(gt, p, max);
+		max_idx = vr_select(gt, vr_set1(k), max_idx);
+	}
+
+	vr_store(idx, max_idx);
+	for (l = 0; l < VR_LANES; l++)
+		out[l] = idx[l];
+}
+
+/*
+ * The same iterations as in frame_newton, VD_LANES frames at once.
+ * Converged lanes are frozen while the rest continue.
+ */
+static void newton_lanes(const FLOAT* x, size_t size, size_t count, double omega_min, double omega_max, double* omega, double* phase)
+{
+	size_t loop, n, l;
+	size_t left = count;
+	int done[VD_LANES];
+	int edge[VD_LANES] = {0};
+	double a[VD_LANES], b[VD_LANES];
+	double Xr[VD_LANES], Xi[VD_LANES], dXr[VD_LANES], dXi[VD_LANES], ddXr[VD_LANES], ddXs[VD_LANES];
+
+	for (l = 0; l < VD_LANES; l++)
+		done[l] = l >= count;
+
+	for (loop = 0; loop <= NEWTON_MAX_LOOPS && left; loop++) {
+		const vd_t one = vd_set1(1.0);
+		vd_t vXr = vd_zero();
+		vd_t vXi = vd_zero();
+		vd_t vdXr = vd_zero();
+		vd_t vdXi = vd_zero();
+		vd_t vddXr = vd_zero();
+		vd_t vddXs = vd_zero();
+		vd_t c = one;
+		vd_t s = vd_zero();
+		vd_t vn = vd_zero();
+		vd_t va, vb;
+
+		for (l = 0; l < VD_LANES; l++) {
+			a[l] = cos(omega[l]);
+			b[l] = sin(omega[l]);
+		}
+		va = vd_load(a);
+		vb = vd_load(b);
+
+		for (n = 0; n < size; n++) {
+			const vd_t p = vd_load_r(x + n * VR_LANES);
+			const vd_t cm = vd_mul(p, c);
+			const vd_t sm = vd_mul(p, s);
+			const vd_t tc = vd_mul(vn, cm);
+			const vd_t ts = vd_mul(vn, sm);
+			const vd_t new_c = vd_sub(vd_mul(va, c), vd_mul(vb, s));
+			const vd_t new_s = vd_add(vd_mul(vb, c), vd_mul(va, s));
+			vXr = vd_add(vXr, cm);
+			vXi = vd_add(vXi, sm);
+			vdXr = vd_sub(vdXr, ts);
+			vdXi = vd_add(vdXi, tc);
+			vddXr = vd_sub(vddXr, vd_mul(vn, tc));
+			vddXs = vd_sub(vddXs, vd_mul(vn, ts));
+			c = new_c;
+			s = new_s;
+			vn = vd_add(vn, one);
+		}
+
+		vd_store(Xr, vXr);
+		vd_store(Xi, vXi);
+		vd_store(dXr, vdXr);
+		vd_store(dXi, vdXi);
+		vd_store(ddXr, vddXr);
+		vd_store(ddXs, vddXs);
+
+		for (l = 0; l < VD_LANES; l++) {
+			double F, G2, dF, dw;
+			if (done[l])
+				continue;
+
+			F = Xr[l] * dXr[l] + Xi[l] * dXi[l];
+			G2 = Xr[l] * Xr[l] + Xi[l] * Xi[l];
+			dF = Xr[l] * ddXr[l] + dXr[l] * dXr[l] + Xi[l] * ddXs[l] + dXi[l] * dXi[l];
+			dw = newton_step(F, dF, G2);
+
+			if (newton_update(dw, omega_min, omega_max, loop == NEWTON_MAX_LOOPS, omega + l, edge + l,
+				Xr + l, Xi + l, dXr[l], dXi[l])) {
+				phase[l] = newton_phase(Xr[l], Xi[l]);
+				done[l] = 1;
+				left--;
+			}
+		}
+	}
+}
+
+void batch_newton(const FLOAT* x, size_t size, size_t count, double omega_min, double omega_max, double* omega, double* phase)
+{
+	size_t l;
+	for (l = 0; l < count; l += VD_LANES)
+		newton_lanes(x + l, size, count - l < VD_LANES ? count - l : VD_LANES, omega_min, omega_max, omega + l, phase + l);
+}
+
+/*
+ * Correlation with regenerated sine, the sine is produced by rotation
+ * instead of sin() call per sample
+ */
+static void magnitude_lanes(const FLOAT* x, size_t size, const double* omega, const double* phase, double* magnitude)
+{
+	size_t n, l;
+	double a[VD_LANES], b[VD_LANES], c0[VD_LANES], s0[VD_LANES], t1[VD_LANES], t2[VD_LANES];
+	vd_t va, vb, c, s;
+	vd_t vt1 = vd_zero();
+	vd_t vt2 = vd_zero();
+
+	for (l = 0; l < VD_LANES; l++) {
+		a[l] = cos(omega[l]);
+		b[l] = sin(omega[l]);
+		c0[l] = cos(phase[l]);
+		s0[l] = sin(phase[l]);
+	}
+	va = vd_load(a);
+	vb = vd_load(b);
+	c = vd_load(c0);
+	s = vd_load(s0);
+
+	for (n = 0; n < size; n++) {
+		const vd_t p = vd_load_r(x + n * VR_LANES);
+		const vd_t new_c = vd_sub(vd_mul(va, c), vd_mul(vb, s));
+		const vd_t new_s = vd_add(vd_mul(vb, c), vd_mul(va, s));
+		vt1 = vd_add(vt1, vd_mul(p, s));
+		vt2 = vd_add(vt2, vd_mul(s, s));
+		c = new_c;
+		s = new_s;
+	}
+
+	vd_store(t1, vt1);
+	vd_store(t2, vt2);
+	for (l = 0; l < VD_LANES; l++)
+		magnitude[l] = t2[l] > 0 ? t1[l] / t2[l] : 0;
+}
+
+void batch_magnitude(const FLOAT* x, size_t size, size_t count, const double* omega, const double* phase, double* magnitude)
+{
+	size_t l;
+	for (l = 0; l < count; l += VD_LANES)
+		magnitude_lanes(x + l, size, omega + l, phase + l, magnitude + l);
+}
+
+/* frequencies evaluated in one pass, accumulators are kept in registers */
+#define GOERTZEL_BLOCK 8
+
+void batch_goertzel(const FLOAT* x, size_t size, const FLOAT* omega, size_t k, FLOAT* power, FLOAT* energy)
+{
+	size_t i, j, n, cnt;
+	vr_t e = vr_zero();
+
+	for (n = 0; n < size; n++) {
+		const vr_t v = vr_load(x + n * VR_LANES);
+		e = vr_add(e, vr_mul(v, v));
+	}
+	vr_store(energy, e);
+
+	for (i = 0; i < k; i += GOERTZEL_BLOCK) {
+		vr_t c[GOERTZEL_BLOCK], s1[GOERTZEL_BLOCK], s2[GOERTZEL_BLOCK];
+		cnt = k - i < GOERTZEL_BLOCK ? k - i : GOERTZEL_BLOCK;
+
+		for (j = 0; j < cnt; j++) {
+			c[j] = vr_set1(2 * cos(omega[i + j]));
+			s1[j] = vr_zero();
+			s2[j] = vr_zero();
+		}
+
+		for (n = 0; n < size; n++) {
+			const vr_t v = vr_load(x + n * VR_LANES);
+			for (j = 0; j < cnt; j++) {
+				const vr_t s0 = vr_sub(vr_add(v, vr_mul(c[j], s1[j])), s2[j]);
+				s2[j] = s1[j];
+				s1[j] = s0;
+			}
+		}
+
+		for (j = 0; j < cnt; j++) {
+			const vr_t p = vr_sub(vr_add(vr_mul(s1[j], s1[j]), vr_mul(s2[j], s2[j])),
+				vr_mul(vr_mul(c[j], s1[j]), s2[j]));
+			vr_store(power + (i + j) * VR_LANES, p);
+		}
+	}
+}
@@ -0,0 +1,146 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "isa.h"
+
+#include <include/libgha.h>
+
+#include <math.h>
+
+/*
+ * Frame parallel kernels. A group of frames is processed at once,
+ * frame l of the group is handled by SIMD lane l.
+ *
+ * Lane interleaved layout: x[i * lanes + l] is sample i of frame l.
+ */
+
+/*
+ * Newton refinement parameters, the same for per frame implementation:
+ * iterations are stopped once the step is below NEWTON_TOLERANCE (radians)
+ */
+#define NEWTON_MAX_LOOPS 8
+#define NEWTON_TOLERANCE 1e-10
+
+/*
+ * Clamp Newton step result to [omega_min, omega_max], returns not zero if it was out of range
+ */
+static inline int newton_clamp(double* omega, double omega_min, double omega_max)
+{
+	if (*omega < omega_min) {
+		*omega = omega_min;
+		return 1;
+	}
+	if (*omega > omega_max) {
+		*omega = omega_max;
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Newton step of omega maximizing |X|^2 (G2) from F = d|X|^2 / 2 and dF = dF / domega,
+ * 0 if there is no extremum: zero frame or flat |X| (frame of one sample)
+ */
+static inline double newton_step(double F, double dF, double G2)
+{
+	const double den = G2 > 0 ? dF - (F * F) / G2 : 0;
+	const double dw = den != 0 ? F / den : 0;
+
+	return isfinite(dw) ? dw : 0;
+}
+
+/*
+ * Apply Newton step dw to omega: the result is folded in to [0, pi] and kept in
+ * [omega_min, omega_max]. Returns not zero if the search is finished: last loop,
+ * converged or the range edge is hit twice in a row. If it is finished without
+ * convergence the transform X is moved to the new frequency by its derivative.
+ */
+static inline int newton_update(double dw, double omega_min, double omega_max, int last,
+	double* omega, int* edge, double* Xr, double* Xi, double dXr, double dXi)
+{
+	const int was_edge = *edge;
+
+	*omega -= dw;
+
+	if (*omega < 0)
+		*omega *= -1;
+
+	while (*omega > M_PI * 2.0)
+		*omega -= M_PI * 2.0;
+
+	if (*omega > M_PI)
+		*omega = M_PI * 2.0 - *omega;
+
+	*edge = newton_clamp(omega, omega_min, omega_max);
+
+	if (!last && fabs(dw) >= NEWTON_TOLERANCE && !(*edge && was_edge))
+		return 0;
+
+	/* not converged, move the transform to the new frequency */
+	if (fabs(dw) >= NEWTON_TOLERANCE && !*edge) {
+		*Xr -= dw * dXr;
+		*Xi -= dw * dXi;
+	}
+
+	return 1;
+}
+
+/*
+ * Phase of zero phase sine from the transform X at its frequency
+ * (sums of x * cos(omega * n) and x * sin(omega * n)), 0 for zero transform
+ */
+static inline double newton_phase(double Xr, double Xi)
+{
+	double phase;
+
+	if (Xr == 0 && Xi == 0)
+		return 0;
+
+	phase = M_PI / 2 - atan(Xi / Xr);
+	if (Xr < 0)
+		phase += M_PI;
+
+	return phase;
+}
+
+/*
+ * Number of frames in a group
+ */
+size_t batch_lanes(void);
+
+/*
+ * Store count (<= lanes) frames of size samples lane interleaved: raw samples
+ * in to raw and multiplied by window in to out. Sample i of frame l is pcm[l][i * stride].
+ * Windowed samples from size up to padded_size and all samples of unused lanes are zeroed.
+ */
+void batch_window(const FLOAT* const* pcm, size_t stride, size_t count, const FLOAT* window, size_t size, size_t padded_size, FLOAT* out, FLOAT* raw);
+
+/*
+ * Index of the bin with max power for each lane,
+ * re, im - lane interleaved bins, out - lanes indexes
+ */
+void batch_argmax(const FLOAT* re, const FLOAT* im, size_t bins, size_t* out);
+
+/*
+ * Newton search of frequency for first count lanes,
+ * x - lane interleaved windowed frames of size samples,
+ * omega - initial frequency, replaced with the result, phase - resulting phase.
+ * The result is kept in [omega_min, omega_max], search stops at the range edge
+ * if it tries to leave the range twice in a row.
+ */
+void batch_newton(const FLOAT* x, size_t size, size_t count, double omega_min, double omega_max, double* omega, double* phase);
+
+/*
+ * Magnitude of the sine with given frequency and phase in each of first count lanes,
+ * x - lane interleaved raw frames of size samples
+ */
+void batch_magnitude(const FLOAT* x, size_t size, size_t count, const double* omega, const double* phase, double* magnitude);
+
+/*
+ * Goertzel power of lane interleaved frames x of size samples at k frequencies,
+ * power[j * lanes + l] is power of lane l at omega[j], energy[l] is sum of
+ * squared samples of lane l
+ */
+void batch_goertzel(const FLOAT* x, size_t size, const FLOAT* omega, size_t k, FLOAT* power, FLOAT* energy);
+
+#endif
@@ -0,0 +1,84 @@
+#include "decimate.h"
+
+#include <math.h>
+
+void decimate_filter(FLOAT* taps, size_t half, size_t factor)
+{
+	size_t i;
+	double sum = 0;
+	const size_t len = 2 * half;
+
+	for (i = 0; i <= half; i++) {
+		const double w = 0.42 - 0.5 * cos(2 * M_PI * (half + i) / len) + 0.08 * cos(4 * M_PI * (half + i) / len);
+		const double h = i == 0 ? 1.0 / factor : i % factor ? sin(M_PI * i / factor) / (M_PI * i) : 0.0;
+		taps[i] = h * w;
+		sum += i ? 2 * taps[i] : taps[i];
+	}
+
+	for (i = 0; i <= half; i++)
+		taps[i] /= sum;
+}
+
+double decimate_response(const FLOAT* taps, size_t half, double omega)
+{
+	size_t i;
+	double h = taps[0];
+
+	for (i = 1; i <= half; i++)
+		h += 2 * taps[i] * cos(omega * i);
+
+	return h;
+}
+
+size_t decimate_size(size_t size, size_t half, size_t factor)
+{
+	if (size <= 2 * half)
+		return 0;
+
+	return (size - 2 * half - 1) / factor + 1;
+}
+
+/*
+ * 4 outputs at once to hide latency of accumulation. Taps at distance of
+ * multiple of factor are zero (sinc zeros), only the half band case is skipped
+ */
+void decimate(const FLOAT* in, const FLOAT* taps, size_t half, size_t factor, const FLOAT* window, FLOAT* out, size_t out_size)
+{
+	size_t i, j;
+	const size_t step = factor == 2 ? 2 : 1;
+
+	for (j = 0; j + 4 <= out_size; j += 4) {
+		const FLOAT* x0 = in + half + j * factor;
+		const FLOAT* x1 = x0 + factor;
+		const FLOAT* x2 = x1 + factor;
+		const FLOAT* x3 = x2 + factor;
+		FLOAT a0 = taps[0] * *x0;
+		FLOAT a1 = taps[0] * *x1;
+		FLOAT a2 = taps[0] * *x2;
+		FLOAT a3 = taps[0] * *x3;
+		for (i = 1; i <= half; i += step) {
+			a0 += taps[i] * (x0[i] + *(x0 - i));
+			a1 += taps[i] * (x1[i] + *(x1 - i));
+			a2 += taps[i] * (x2[i] + *(x2 - i));
+			a3 += taps[i] * (x3[i] + *(x3 - i));
+		}
+		out[j] = a0;
+		out[j + 1] = a1;
+		out[j + 2] = a2;
+		out[j + 3] = a3;
+	}
+
+	for (; j < out_size; j++) {
+		const FLOAT* x = in + half + j * factor;
+		FLOAT acc = taps[0] * *x;
+		for (i = 1; i <= half; i += step)
+			acc += taps[i] * (x[i] + *(x - i));
+		out[j] = acc;
+	}
+
+	if (!window)
+		return;
+
+	for (j = 0; j < out_size; j++)
+		out[j] *= window[j];
+}
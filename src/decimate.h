@@ -0,0 +1,33 @@
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+#include <include/libgha.h>
+
+/*
+ * Low pass filtering with decimation. The filter is symmetric FIR
+ * of 2 * half + 1 taps, taps[i] is the tap at distance i from the center.
+ */
+
+/*
+ * Blackman windowed sinc with cutoff pi / factor and unit gain at DC
+ */
+void decimate_filter(FLOAT* taps, size_t half, size_t factor);
+
+/*
+ * Zero phase frequency response of the filter at omega
+ */
+double decimate_response(const FLOAT* taps, size_t half, double omega);
+
+/*
+ * Number of output samples of size input samples, only outputs
+ * with full filter support are calculated, 0 if there is no one
+ */
+size_t decimate_size(size_t size, size_t half, size_t factor);
+
+/*
+ * out[j] = filtered in[half + j * factor] * window[j] for j in [0, out_size),
+ * window may be null
+ */
+void decimate(const FLOAT* in, const FLOAT* taps, size_t half, size_t factor, const FLOAT* window, FLOAT* out, size_t out_size);
+
+#endif
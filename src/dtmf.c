@@ -0,0 +1,303 @@
+#include <include/libgha_dtmf.h>
+
+#include "kernels.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define DTMF_RATE 8000
+/* min time a digit should be valid (and invalid before next one), samples */
+#define DTMF_MIN_DURATION 200
+/* screening: power of the strongest tone in group over the next one */
+#define DTMF_GROUP_RATIO 4.0
+/* screening: part of the frame energy in the two strongest tones */
+#define DTMF_SCREEN_PART 0.3
+/* silence gate, mean square of the frame */
+#define DTMF_MIN_POWER 1e-4
+/* validation: max relative frequency deviation */
+#define DTMF_MAX_DEVIATION 0.02
+/* validation: part of the frame energy explained by the two refined tones */
+#define DTMF_MIN_FIT 0.8
+
+static const double dtmf_freq[8] = {697, 770, 852, 941, 1209, 1336, 1477, 1633};
+
+static const char dtmf_digits[4][4] = {
+	{'1', '2', '3', 'A'},
+	{'4', '5', '6', 'B'},
+	{'7', '8', '9', 'C'},
+	{'*', '0', '#', 'D'}
+};
+
+struct dtmf_channel {
+	/* digit of the last frames and number of such frames, 0 - no digit */
+	char digit;
+	size_t count;
+	/* digit was reported and not released yet */
+	int reported;
+	size_t frame;
+};
+
+struct gha_dtmf {
+	size_t channels;
+	size_t frame_size;
+	/* number of frames of DTMF_MIN_DURATION */
+	size_t min_frames;
+	size_t lanes;
+	const struct kernels* kernels;
+	gha_ctx_t ctx;
+
+	FLOAT omega[8];
+	/* allowed high to low magnitude ratio */
+	FLOAT twist_max;
+	FLOAT twist_min;
+
+	/* frame_size ones, the frames are not windowed for screening */
+	FLOAT* ones;
+	/* decoded frames, lanes * frame_size */
+	FLOAT* rows;
+	/* lane interleaved frames, frame_size * lanes */
+	FLOAT* raw;
+	/* Goertzel power at 8 frequencies and energy, lane interleaved */
+	FLOAT* power;
+	FLOAT* energy;
+
+	struct dtmf_channel* state;
+};
+
+gha_dtmf_t gha_dtmf_create(size_t channels, size_t frame_size)
+{
+	size_t i;
+	gha_dtmf_t dtmf;
+
+	if (channels == 0 || frame_size < 80)
+		return NULL;
+
+	dtmf = malloc(sizeof(struct gha_dtmf));
+	if (!dtmf)
+		return NULL;
+
+	dtmf->channels = channels;
+	dtmf->frame_size = frame_size;
+	dtmf->min_frames = (DTMF_MIN_DURATION + frame_size - 1) / frame_size;
+	dtmf->kernels = kernels_select();
+	dtmf->lanes = dtmf->kernels->batch.lanes();
+
+	for (i = 0; i < 8; i++)
+		dtmf->omega[i] = 2 * M_PI * dtmf_freq[i] / DTMF_RATE;
+
+	gha_dtmf_set_twist(4, 8, dtmf);
+
+	dtmf->ctx = gha_create_ctx(frame_size);
+	if (!dtmf->ctx)
+		goto exit_free_dtmf;
+
+	/* ones + rows + raw + power + energy */
+	dtmf->ones = malloc(sizeof(FLOAT) * (frame_size + frame_size * dtmf->lanes * 2 + 9 * dtmf->lanes));
+	if (!dtmf->ones)
+		goto exit_free_ctx;
+
+	dtmf->rows = dtmf->ones + frame_size;
+	dtmf->raw = dtmf->rows + frame_size * dtmf->lanes;
+	dtmf->power = dtmf->raw + frame_size * dtmf->lanes;
+	dtmf->energy = dtmf->power + 8 * dtmf->lanes;
+
+	for (i = 0; i < frame_size; i++)
+		dtmf->ones[i] = 1.0;
+
+	dtmf->state = calloc(channels, sizeof(struct dtmf_channel));
+	if (!dtmf->state)
+		goto exit_free_buf;
+
+	return dtmf;
+exit_free_buf:
+	free(dtmf->ones);
+exit_free_ctx:
+	gha_free_ctx(dtmf->ctx);
+exit_free_dtmf:
+	free(dtmf);
+	return NULL;
+}
+
+void gha_dtmf_free(gha_dtmf_t dtmf)
+{
+	free(dtmf->state);
+	free(dtmf->ones);
+	gha_free_ctx(dtmf->ctx);
+	free(dtmf);
+}
+
+void gha_dtmf_set_twist(FLOAT normal, FLOAT reverse, gha_dtmf_t dtmf)
+{
+	dtmf->twist_max = pow(10, normal / 20);
+	dtmf->twist_min = pow(10, -reverse / 20);
+}
+
+/*
+ * Find the strongest of 4 tones starting from first, returns not zero if it dominates
+ */
+static int dtmf_dominant(const FLOAT* power, size_t lanes, size_t l, int first, int* idx)
+{
+	int j;
+	FLOAT max = 0;
+	FLOAT next = 0;
+
+	for (j = first; j < first + 4; j++) {
+		const FLOAT p = power[j * lanes + l];
+		if (p > max) {
+			next = max;
+			max = p;
+			*idx = j;
+		} else if (p > next) {
+			next = p;
+		}
+	}
+
+	return max > next * DTMF_GROUP_RATIO;
+}
+
+/*
+ * Returns digit of lane l or 0
+ */
+static char dtmf_check(gha_dtmf_t dtmf, size_t l, const FLOAT* frame, struct gha_info* info)
+{
+	int lo = 0, hi = 4;
+	FLOAT fit[2];
+	FLOAT cand[2];
+	FLOAT twist;
+	const size_t n = dtmf->frame_size;
+	const FLOAT energy = dtmf->energy[l];
+	/* rectangular window Goertzel power of sine with amplitude a is (a * n / 2)^2 and its energy is a^2 * n / 2 */
+	const FLOAT scale = 2.0 / n;
+
+	if (energy < DTMF_MIN_POWER * n)
+		return 0;
+
+	if (!dtmf_dominant(dtmf->power, dtmf->lanes, l, 0, &lo) || !dtmf_dominant(dtmf->power, dtmf->lanes, l, 4, &hi))
+		return 0;
+
+	if ((dtmf->power[lo * dtmf->lanes + l] + dtmf->power[hi * dtmf->lanes + l]) * scale < DTMF_SCREEN_PART * energy)
+		return 0;
+
+	cand[0] = dtmf->omega[lo];
+	cand[1] = dtmf->omega[hi];
+	gha_analyze_candidates(frame, cand, 2, info, fit, dtmf->ctx);
+
+	if (fabs(info[0].frequency - cand[0]) > DTMF_MAX_DEVIATION * cand[0] ||
+		fabs(info[1].frequency - cand[1]) > DTMF_MAX_DEVIATION * cand[1])
+		return 0;
+
+	if (fit[0] + fit[1] < DTMF_MIN_FIT)
+		return 0;
+
+	twist = fabs(info[1].magnitude) / fabs(info[0].magnitude);
+	if (twist > dtmf->twist_max || twist < dtmf->twist_min)
+		return 0;
+
+	return dtmf_digits[lo][hi - 4];
+}
+
+/*
+ * Update channel state with digit of its next frame, returns 1 if event was written
+ */
+static int dtmf_update(gha_dtmf_t dtmf, size_t channel, char digit, const struct gha_info* info, struct gha_dtmf_event* event)
+{
+	struct dtmf_channel* st = dtmf->state + channel;
+	int rv = 0;
+
+	if (digit == st->digit) {
+		st->count++;
+	} else {
+		st->digit = digit;
+		st->count = 1;
+	}
+
+	if (!digit && st->count >= dtmf->min_frames)
+		st->reported = 0;
+
+	if (digit && st->count >= dtmf->min_frames && !st->reported) {
+		event->channel = channel;
+		event->digit = digit;
+		event->frame = st->frame;
+		event->low = info[0];
+		event->high = info[1];
+		st->reported = 1;
+		rv = 1;
+	}
+
+	st->frame++;
+
+	return rv;
+}
+
+/*
+ * Screen and validate group of count (<= lanes) decoded frames
+ */
+static size_t dtmf_group(gha_dtmf_t dtmf, size_t first, size_t count, const FLOAT* const* frames, struct gha_dtmf_event* events)
+{
+	size_t l;
+	size_t ev = 0;
+	const struct kernels* k = dtmf->kernels;
+
+	/* window of ones, so windowed and raw output are the same */
+	k->batch.window(frames, 1, count, dtmf->ones, dtmf->frame_size, dtmf->frame_size, dtmf->raw, dtmf->raw);
+	k->batch.goertzel(dtmf->raw, dtmf->frame_size, dtmf->omega, 8, dtmf->power, dtmf->energy);
+
+	for (l = 0; l < count; l++) {
+		struct gha_info info[2];
+		const char digit = dtmf_check(dtmf, l, frames[l], info);
+		ev += dtmf_update(dtmf, first + l, digit, info, events + ev);
+	}
+
+	return ev;
+}
+
+size_t gha_dtmf_process(gha_dtmf_t dtmf, size_t first, size_t count, const FLOAT* const* frames, struct gha_dtmf_event* events)
+{
+	size_t i, cnt;
+	size_t ev = 0;
+
+	if (first > dtmf->channels || count > dtmf->channels - first)
+		return 0;
+
+	for (i = 0; i < count; i += dtmf->lanes) {
+		cnt = count - i < dtmf->lanes ? count - i : dtmf->lanes;
+		ev += dtmf_group(dtmf, first + i, cnt, frames + i, events + ev);
+	}
+
+	return ev;
+}
+
+static size_t dtmf_process_pcm(gha_dtmf_t dtmf, size_t first, size_t count, const void* const* frames,
+	enum pcm_format format, struct gha_dtmf_event* events)
+{
+	size_t i, l, cnt;
+	size_t ev = 0;
+	const FLOAT* rows[dtmf->lanes];
+
+	if (first > dtmf->channels || count > dtmf->channels - first)
+		return 0;
+
+	for (i = 0; i < count; i += dtmf->lanes) {
+		cnt = count - i < dtmf->lanes ? count - i : dtmf->lanes;
+		for (l = 0; l < cnt; l++) {
+			FLOAT* row = dtmf->rows + l * dtmf->frame_size;
+			/* window of ones, so the same row can be used for both outputs */
+			dtmf->kernels->pcm.window(frames[i + l], format, dtmf->ones, dtmf->frame_size, row, row);
+			rows[l] = row;
+		}
+		ev += dtmf_group(dtmf, first + i, cnt, rows, events + ev);
+	}
+
+	return ev;
+}
+
+size_t gha_dtmf_process_s16(gha_dtmf_t dtmf, size_t first, size_t count, const int16_t* const* frames, struct gha_dtmf_event* events)
+{
+	return dtmf_process_pcm(dtmf, first, count, (const void* const*)frames, PCM_S16, events);
+}
+
+size_t gha_dtmf_process_ulaw(gha_dtmf_t dtmf, size_t first, size_t count, const uint8_t* const* frames, struct gha_dtmf_event* events)
+{
+	return dtmf_process_pcm(dtmf, first, count, (const void* const*)frames, PCM_ULAW, events);
+}
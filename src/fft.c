@@ -0,0 +1,274 @@
+#include "fft.h"
+
+#include <tools/kiss_fftr.h>
+
+#include <math.h>
+
+#ifdef GHA_USE_R4_FFT
+#include "fft_r4.h"
+#endif
+#ifdef GHA_USE_BLUESTEIN_FFT
+#include "fft_bluestein.h"
+#endif
+
+struct fft {
+	size_t size;
+	kiss_fftr_cfg fftr;
+	/* complex transform for odd sizes */
+	kiss_fft_cfg cfg;
+	kiss_fft_cpx* cpx_buf;
+#ifdef GHA_USE_R4_FFT
+	struct fft_r4* r4;
+#endif
+#ifdef GHA_USE_BLUESTEIN_FFT
+	struct fft_bluestein* bluestein;
+#endif
+};
+
+struct fft* fft_alloc(size_t size)
+{
+	struct fft* fft;
+
+	if (size == 0)
+		return NULL;
+
+	fft = malloc(sizeof(struct fft));
+	if (!fft)
+		return NULL;
+
+	fft->size = size;
+	fft->fftr = NULL;
+	fft->cfg = NULL;
+	fft->cpx_buf = NULL;
+
+#ifdef GHA_USE_R4_FFT
+	fft->r4 = NULL;
+#endif
+#ifdef GHA_USE_BLUESTEIN_FFT
+	fft->bluestein = NULL;
+#endif
+
+#ifdef GHA_USE_R4_FFT
+	if (fft_r4_supported(size)) {
+		fft->r4 = fft_r4_alloc(size);
+		if (!fft->r4)
+			goto exit_free_fft;
+		return fft;
+	}
+#endif
+#ifdef GHA_USE_BLUESTEIN_FFT
+	if (fft_bluestein_preferred(size)) {
+		fft->bluestein = fft_bluestein_alloc(size);
+		if (!fft->bluestein)
+			goto exit_free_fft;
+		return fft;
+	}
+#endif
+
+	if (size % 2) {
+		fft->cfg = kiss_fft_alloc(size, 0, NULL, NULL);
+		if (!fft->cfg)
+			goto exit_free_fft;
+		fft->cpx_buf = malloc(sizeof(kiss_fft_cpx) * size * 2);
+		if (!fft->cpx_buf)
+			goto exit_free_cfg;
+		return fft;
+	}
+
+	fft->fftr = kiss_fftr_alloc(size, 0, NULL, NULL);
+	if (!fft->fftr)
+		goto exit_free_fft;
+
+	return fft;
+exit_free_cfg:
+	kiss_fft_free(fft->cfg);
+exit_free_fft:
+	free(fft);
+	return NULL;
+}
+
+struct fft* fft_alloc_cpx(size_t size)
+{
+	struct fft* fft;
+
+	if (size == 0)
+		return NULL;
+
+	fft = malloc(sizeof(struct fft));
+	if (!fft)
+		return NULL;
+
+	fft->size = size;
+	fft->fftr = NULL;
+	fft->cfg = NULL;
+
+	/* split re/im buffer for radix-4 */
+	fft->cpx_buf = malloc(sizeof(kiss_fft_cpx) * size);
+	if (!fft->cpx_buf)
+		goto exit_free_fft;
+
+#ifdef GHA_USE_R4_FFT
+	fft->r4 = NULL;
+#endif
+#ifdef GHA_USE_BLUESTEIN_FFT
+	fft->bluestein = NULL;
+#endif
+
+	/* the same conditions as for real transform of twice bigger size */
+#ifdef GHA_USE_R4_FFT
+	if (fft_r4_supported(size * 2)) {
+		fft->r4 = fft_r4_alloc_cpx(size);
+		if (!fft->r4)
+			goto exit_free_buf;
+		return fft;
+	}
+#endif
+#ifdef GHA_USE_BLUESTEIN_FFT
+	if (fft_bluestein_preferred(size * 2)) {
+		fft->bluestein = fft_bluestein_alloc_cpx(size);
+		if (!fft->bluestein)
+			goto exit_free_buf;
+		return fft;
+	}
+#endif
+
+	fft->cfg = kiss_fft_alloc(size, 0, NULL, NULL);
+	if (!fft->cfg)
+		goto exit_free_buf;
+
+	return fft;
+exit_free_buf:
+	free(fft->cpx_buf);
+exit_free_fft:
+	free(fft);
+	return NULL;
+}
+
+void fft_free(struct fft* fft)
+{
+#ifdef GHA_USE_R4_FFT
+	if (fft->r4)
+		fft_r4_free(fft->r4);
+#endif
+#ifdef GHA_USE_BLUESTEIN_FFT
+	if (fft->bluestein)
+		fft_bluestein_free(fft->bluestein);
+#endif
+	if (fft->cfg)
+		kiss_fft_free(fft->cfg);
+	if (fft->fftr)
+		kiss_fftr_free(fft->fftr);
+	free(fft->cpx_buf);
+	free(fft);
+}
+
+static void fft_real_odd(struct fft* fft, const FLOAT* in, kiss_fft_cpx* out)
+{
+	size_t i;
+	kiss_fft_cpx* cpx_in = fft->cpx_buf;
+	kiss_fft_cpx* cpx_out = fft->cpx_buf + fft->size;
+
+	for (i = 0; i < fft->size; i++) {
+		cpx_in[i].r = in[i];
+		cpx_in[i].i = 0;
+	}
+
+	kiss_fft(fft->cfg, cpx_in, cpx_out);
+
+	memcpy(out, cpx_out, sizeof(kiss_fft_cpx) * (fft->size / 2 + 1));
+}
+
+void fft_real(struct fft* fft, const FLOAT* in, kiss_fft_cpx* out)
+{
+#ifdef GHA_USE_R4_FFT
+	if (fft->r4) {
+		fft_r4_real(fft->r4, in, out);
+		return;
+	}
+#endif
+#ifdef GHA_USE_BLUESTEIN_FFT
+	if (fft->bluestein) {
+		fft_bluestein_real(fft->bluestein, in, out);
+		return;
+	}
+#endif
+	if (fft->cfg) {
+		fft_real_odd(fft, in, out);
+		return;
+	}
+	kiss_fftr(fft->fftr, in, out);
+}
+
+void fft_cpx(struct fft* fft, const kiss_fft_cpx* in, kiss_fft_cpx* out)
+{
+#ifdef GHA_USE_R4_FFT
+	if (fft->r4) {
+		size_t i;
+		FLOAT* re = (FLOAT*)fft->cpx_buf;
+		FLOAT* im = re + fft->size;
+
+		for (i = 0; i < fft->size; i++) {
+			re[i] = in[i].r;
+			im[i] = in[i].i;
+		}
+
+		fft_r4_cpx(fft->r4, re, im);
+
+		for (i = 0; i < fft->size; i++) {
+			out[i].r = re[i];
+			out[i].i = im[i];
+		}
+		return;
+	}
+#endif
+#ifdef GHA_USE_BLUESTEIN_FFT
+	if (fft->bluestein) {
+		fft_bluestein_cpx(fft->bluestein, in, out);
+		return;
+	}
+#endif
+	kiss_fft(fft->cfg, in, out);
+}
+
+size_t fft_batch_lanes(struct fft* fft)
+{
+#ifdef GHA_USE_R4_FFT
+	if (fft->r4)
+		return fft_r4_batch_lanes();
+#endif
+	return 0;
+}
+
+void fft_real_batch(struct fft* fft, const FLOAT* in, FLOAT* out_re, FLOAT* out_im, FLOAT* work)
+{
+#ifdef GHA_USE_R4_FFT
+	fft_r4_real_batch(fft->r4, in, out_re, out_im, work);
+#endif
+}
+
+#ifdef GHA_USE_R4_FFT
+/*
+ * Time of kiss_fftr relative to radix-4 transform per point and log2(size),
+ * measured for sizes 200 - 33000 with and without AVX2 kernels
+ */
+#define FFT_KISS_COST 2.5
+
+static double fft_cost(size_t size)
+{
+	return size * log2(size);
+}
+#endif
+
+size_t fft_next_fast_size(size_t n)
+{
+	const size_t k = kiss_fftr_next_fast_size_real(n);
+#ifdef GHA_USE_R4_FFT
+	size_t p = 1;
+	while (p < n)
+		p *= 2;
+	/* power of two up to about twice bigger is still cheaper than 2, 3, 5 size */
+	if (fft_r4_supported(p) && fft_cost(p) <= FFT_KISS_COST * fft_cost(k))
+		return p;
+#endif
+	return k;
+}
@@ -0,0 +1,60 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include "isa.h"
+
+#include <include/libgha.h>
+
+#include <kiss_fft.h>
+
+/*
+ * Real forward FFT used by GHA.
+ *
+ * Selects the best available implementation for given size:
+ * radix-4 for powers of two, Bluestein for sizes with big prime
+ * factors and kiss_fftr otherwise.
+ * Output format is the same as kiss_fftr one: size/2 + 1 unscaled bins.
+ */
+
+struct fft;
+
+/*
+ * Any non zero size is supported, odd sizes are transformed
+ * as complex sequence.
+ * returns null in case of fail
+ */
+struct fft* fft_alloc(size_t size);
+
+void fft_free(struct fft* fft);
+
+void fft_real(struct fft* fft, const FLOAT* in, kiss_fft_cpx* out);
+
+/*
+ * Complex forward FFT, in and out - size points, the implementation is
+ * selected as for real transform of 2 * size points.
+ * Plan created by fft_alloc_cpx can be used only with fft_cpx.
+ */
+struct fft* fft_alloc_cpx(size_t size);
+
+void fft_cpx(struct fft* fft, const kiss_fft_cpx* in, kiss_fft_cpx* out);
+
+/*
+ * Number of frames transformed at once by fft_real_batch,
+ * 0 if batched transform is not available for this size.
+ */
+size_t fft_batch_lanes(struct fft* fft);
+
+/*
+ * in - lane interleaved real input, in[i * lanes + l] is sample i of frame l
+ * out_re, out_im - lane interleaved (size/2 + 1) * lanes bins
+ * work - 2 * size * lanes values
+ */
+void fft_real_batch(struct fft* fft, const FLOAT* in, FLOAT* out_re, FLOAT* out_im, FLOAT* work);
+
+/*
+ * Returns size >= n with the cheapest transform: the next power of two for
+ * radix-4 or the next kiss_fftr size (factors 2, 3 and 5) if it is cheaper
+ */
+size_t fft_next_fast_size(size_t n);
+
+#endif
@@ -0,0 +1,295 @@
+#include "fft_bluestein.h"
+#include "fft_r4.h"
+#include "simd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+struct fft_bluestein {
+	/* even size is packed in to n / 2 complex points */
+	int packed;
+	/* complex size, n / 2 or n */
+	size_t m;
+	/* power of two convolution size, M >= 2 * m - 1 */
+	size_t M;
+	struct fft_r4* r4;
+	/* exp(-i * pi * k^2 / m), m points */
+	FLOAT* chirp_re;
+	FLOAT* chirp_im;
+	/* transformed conjugated chirp scaled by 1 / M, M points */
+	FLOAT* kern_re;
+	FLOAT* kern_im;
+	/* real post processing twiddles, m points, packed only */
+	FLOAT* post_re;
+	FLOAT* post_im;
+	/* work buffer, M points */
+	FLOAT* buf_re;
+	FLOAT* buf_im;
+};
+
+static size_t conv_size(size_t m)
+{
+	size_t M = FFT_R4_MIN_SIZE / 2;
+	while (M < 2 * m - 1)
+		M *= 2;
+	return M;
+}
+
+/*
+ * Rough cost estimation in the same units (complex transform of size m).
+ * kiss_fft does about log2(p) work per point for radix p <= 5 and
+ * O(p) in generic butterfly for other prime factors. Bluestein does
+ * two power of two transforms of size M, radix-4 is faster per point.
+ */
+int fft_bluestein_preferred(size_t n)
+{
+	size_t p, rest;
+	const size_t m = n % 2 ? n : n / 2;
+	double kiss_cost = 0.0;
+	double bluestein_cost;
+
+	if (n < FFT_R4_MIN_SIZE)
+		return 0;
+
+	rest = m;
+	for (p = 2; p * p <= rest; p++) {
+		while (rest % p == 0) {
+			kiss_cost += p <= 5 ? log2(p) : p;
+			rest /= p;
+		}
+	}
+	if (rest > 1)
+		kiss_cost += rest <= 5 ? log2(rest) : rest;
+	kiss_cost *= m;
+
+	bluestein_cost = 0.6 * conv_size(m) * log2(conv_size(m));
+
+	return kiss_cost > bluestein_cost;
+}
+
+static void fft_bluestein_init(struct fft_bluestein* plan)
+{
+	size_t k;
+	const size_t m = plan->m;
+	const size_t M = plan->M;
+
+	for (k = 0; k < m; k++) {
+		/* k^2 mod 2m keeps argument small for big k */
+		const unsigned long long kk = (unsigned long long)k * k % (2 * m);
+		const double a = -M_PI * kk / m;
+		plan->chirp_re[k] = cos(a);
+		plan->chirp_im[k] = sin(a);
+	}
+
+	memset(plan->kern_re, 0, sizeof(FLOAT) * M);
+	memset(plan->kern_im, 0, sizeof(FLOAT) * M);
+	plan->kern_re[0] = plan->chirp_re[0];
+	plan->kern_im[0] = -plan->chirp_im[0];
+	for (k = 1; k < m; k++) {
+		plan->kern_re[k] = plan->kern_re[M - k] = plan->chirp_re[k];
+		plan->kern_im[k] = plan->kern_im[M - k] = -plan->chirp_im[k];
+	}
+
+	fft_r4_cpx(plan->r4, plan->kern_re, plan->kern_im);
+
+	for (k = 0; k < M; k++) {
+		plan->kern_re[k] /= M;
+		plan->kern_im[k] /= M;
+	}
+
+	if (plan->packed)
+		fft_r4_init_post(plan->post_re, plan->post_im, m * 2);
+}
+
+static struct fft_bluestein* fft_bluestein_alloc_plan(size_t m, int packed)
+{
+	size_t M;
+	struct fft_bluestein* plan;
+
+	if (m == 0)
+		return NULL;
+
+	plan = malloc(sizeof(struct fft_bluestein));
+	if (!plan)
+		return NULL;
+
+	plan->packed = packed;
+	plan->m = m;
+	plan->M = M = conv_size(plan->m);
+
+	plan->r4 = fft_r4_alloc_cpx(M);
+	if (!plan->r4)
+		goto exit_free_plan;
+
+	plan->chirp_re = malloc(sizeof(FLOAT) * (plan->m + M) * 4);
+	if (!plan->chirp_re)
+		goto exit_free_r4;
+
+	plan->chirp_im = plan->chirp_re + plan->m;
+	plan->post_re = plan->chirp_im + plan->m;
+	plan->post_im = plan->post_re + plan->m;
+	plan->kern_re = plan->post_im + plan->m;
+	plan->kern_im = plan->kern_re + M;
+	plan->buf_re = plan->kern_im + M;
+	plan->buf_im = plan->buf_re + M;
+
+	fft_bluestein_init(plan);
+
+	return plan;
+exit_free_r4:
+	fft_r4_free(plan->r4);
+exit_free_plan:
+	free(plan);
+	return NULL;
+}
+
+struct fft_bluestein* fft_bluestein_alloc(size_t n)
+{
+	return fft_bluestein_alloc_plan(n % 2 ? n : n / 2, n % 2 == 0);
+}
+
+struct fft_bluestein* fft_bluestein_alloc_cpx(size_t m)
+{
+	return fft_bluestein_alloc_plan(m, 0);
+}
+
+void fft_bluestein_free(struct fft_bluestein* plan)
+{
+	free(plan->chirp_re);
+	fft_r4_free(plan->r4);
+	free(plan);
+}
+
+/*
+ * Multiply m interleaved complex points by chirp in to work buffer
+ */
+static void bluestein_chirp(struct fft_bluestein* plan, const FLOAT* in)
+{
+	size_t k;
+	const size_t m = plan->m;
+
+	for (k = 0; k + VR_LANES <= m; k += VR_LANES) {
+		vr_t zr, zi, ar, ai;
+		vr_deinterleave2(vr_load(in + 2 * k), vr_load(in + 2 * k + VR_LANES), &zr, &zi);
+		vr_cmul(zr, zi, vr_load(plan->chirp_re + k), vr_load(plan->chirp_im + k), &ar, &ai);
+		vr_store(plan->buf_re + k, ar);
+		vr_store(plan->buf_im + k, ai);
+	}
+	for (; k < m; k++) {
+		const FLOAT zr = in[2 * k];
+		const FLOAT zi = in[2 * k + 1];
+		plan->buf_re[k] = zr * plan->chirp_re[k] - zi * plan->chirp_im[k];
+		plan->buf_im[k] = zr * plan->chirp_im[k] + zi * plan->chirp_re[k];
+	}
+}
+
+/*
+ * Convolution of chirped work buffer with the kernel, the result is conjugated
+ */
+static void bluestein_convolve(struct fft_bluestein* plan)
+{
+	size_t k;
+	const size_t m = plan->m;
+	const size_t M = plan->M;
+	const vr_t zero = vr_zero();
+
+	memset(plan->buf_re + m, 0, sizeof(FLOAT) * (M - m));
+	memset(plan->buf_im + m, 0, sizeof(FLOAT) * (M - m));
+
+	fft_r4_cpx(plan->r4, plan->buf_re, plan->buf_im);
+
+	/* inverse transform is done as conj(fft(conj(x))) */
+	for (k = 0; k < M; k += VR_LANES) {
+		vr_t pr, pi;
+		vr_cmul(vr_load(plan->buf_re + k), vr_load(plan->buf_im + k),
+			vr_load(plan->kern_re + k), vr_load(plan->kern_im + k), &pr, &pi);
+		vr_store(plan->buf_re + k, pr);
+		vr_store(plan->buf_im + k, vr_sub(zero, pi));
+	}
+
+	fft_r4_cpx(plan->r4, plan->buf_re, plan->buf_im);
+}
+
+/*
+ * Conjugate first m points of work buffer and multiply by chirp in place
+ */
+static void bluestein_unchirp(struct fft_bluestein* plan)
+{
+	size_t k;
+	const size_t m = plan->m;
+	const vr_t zero = vr_zero();
+
+	for (k = 0; k + VR_LANES <= m; k += VR_LANES) {
+		vr_t zr, zi;
+		vr_cmul(vr_load(plan->buf_re + k), vr_sub(zero, vr_load(plan->buf_im + k)),
+			vr_load(plan->chirp_re + k), vr_load(plan->chirp_im + k), &zr, &zi);
+		vr_store(plan->buf_re + k, zr);
+		vr_store(plan->buf_im + k, zi);
+	}
+	for (; k < m; k++) {
+		const FLOAT qr = plan->buf_re[k];
+		const FLOAT qi = -plan->buf_im[k];
+		plan->buf_re[k] = qr * plan->chirp_re[k] - qi * plan->chirp_im[k];
+		plan->buf_im[k] = qr * plan->chirp_im[k] + qi * plan->chirp_re[k];
+	}
+}
+
+void fft_bluestein_real(struct fft_bluestein* plan, const FLOAT* in, kiss_fft_cpx* out)
+{
+	size_t k;
+	const size_t m = plan->m;
+
+	if (plan->packed) {
+		/* pack real input and multiply by chirp */
+		bluestein_chirp(plan, in);
+	} else {
+		for (k = 0; k + VR_LANES <= m; k += VR_LANES) {
+			const vr_t x = vr_load(in + k);
+			vr_store(plan->buf_re + k, vr_mul(x, vr_load(plan->chirp_re + k)));
+			vr_store(plan->buf_im + k, vr_mul(x, vr_load(plan->chirp_im + k)));
+		}
+		for (; k < m; k++) {
+			plan->buf_re[k] = in[k] * plan->chirp_re[k];
+			plan->buf_im[k] = in[k] * plan->chirp_im[k];
+		}
+	}
+
+	bluestein_convolve(plan);
+
+	if (!plan->packed) {
+		for (k = 0; k <= m / 2; k++) {
+			const FLOAT qr = plan->buf_re[k];
+			const FLOAT qi = -plan->buf_im[k];
+			out[k].r = qr * plan->chirp_re[k] - qi * plan->chirp_im[k];
+			out[k].i = qr * plan->chirp_im[k] + qi * plan->chirp_re[k];
+		}
+		return;
+	}
+
+	bluestein_unchirp(plan);
+
+	fft_r4_post(plan->buf_re, plan->buf_im, m, plan->post_re, plan->post_im, out);
+}
+
+void fft_bluestein_cpx(struct fft_bluestein* plan, const kiss_fft_cpx* in, kiss_fft_cpx* out)
+{
+	size_t k;
+	const size_t m = plan->m;
+	FLOAT* dst = (FLOAT*)out;
+
+	bluestein_chirp(plan, (const FLOAT*)in);
+	bluestein_convolve(plan);
+	bluestein_unchirp(plan);
+
+	for (k = 0; k + VR_LANES <= m; k += VR_LANES) {
+		vr_t lo, hi;
+		vr_interleave2(vr_load(plan->buf_re + k), vr_load(plan->buf_im + k), &lo, &hi);
+		vr_store(dst + 2 * k, lo);
+		vr_store(dst + 2 * k + VR_LANES, hi);
+	}
+	for (; k < m; k++) {
+		out[k].r = plan->buf_re[k];
+		out[k].i = plan->buf_im[k];
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef FFT_BLUESTEIN_H
+#define FFT_BLUESTEIN_H
+
+#include "isa.h"
+
+#include <include/libgha.h>
+
+#include <kiss_fft.h>
+
+/*
+ * Bluestein (chirp-z) real and complex FFT.
+ *
+ * DFT of n/2 packed complex points (or n points for odd n) is computed
+ * as convolution with a chirp using power of two radix-4 FFT, so cost is
+ * O(n * log(n)) for any n regardless of its prime factors.
+ * Output format is the same as kiss_fftr one.
+ */
+
+struct fft_bluestein;
+
+/*
+ * Returns not zero if Bluestein is expected to be faster than
+ * mixed radix kiss_fft for given real size
+ */
+int fft_bluestein_preferred(size_t n);
+
+/*
+ * n - real fft size
+ * returns null in case of fail
+ */
+struct fft_bluestein* fft_bluestein_alloc(size_t n);
+
+void fft_bluestein_free(struct fft_bluestein* plan);
+
+void fft_bluestein_real(struct fft_bluestein* plan, const FLOAT* in, kiss_fft_cpx* out);
+
+/*
+ * Complex forward FFT of m points, plan created by fft_bluestein_alloc_cpx
+ * can be used only with fft_bluestein_cpx.
+ * fft_bluestein_preferred(2 * m) tells if it is faster than kiss_fft.
+ */
+struct fft_bluestein* fft_bluestein_alloc_cpx(size_t m);
+
+void fft_bluestein_cpx(struct fft_bluestein* plan, const kiss_fft_cpx* in, kiss_fft_cpx* out);
+
+#endif
@@ -0,0 +1,542 @@
+#include "fft_r4.h"
+#include "simd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ * Stockham autosort formulation, stage with length L and stride s
+ * reads x[q + s * (p + j * L / 4)] and writes y[q + s * (4 * p + j)],
+ * so no bit reversal pass is needed.
+ */
+
+struct fft_r4 {
+	/* real size, 0 for complex plan */
+	size_t n;
+	/* complex size */
+	size_t m;
+	/* per radix-4 stage: w1 re, w1 im, w2 re, w2 im, w3 re, w3 im, L/4 values each */
+	FLOAT* tw;
+	/* real post processing twiddles, real plan only */
+	FLOAT* post_re;
+	FLOAT* post_im;
+	/* two split complex buffers of m points */
+	FLOAT* buf;
+};
+
+static int is_pow2(size_t n)
+{
+	return (n & (n - 1)) == 0;
+}
+
+int fft_r4_supported(size_t n)
+{
+	/* Without vector extension kiss_fftr is faster */
+	if (VR_LANES == 1)
+		return 0;
+	return n >= FFT_R4_MIN_SIZE && is_pow2(n);
+}
+
+int fft_r4_cpx_supported(size_t m)
+{
+	return m >= FFT_R4_MIN_SIZE / 2 && is_pow2(m);
+}
+
+void fft_r4_init_post(FLOAT* wr, FLOAT* wi, size_t n)
+{
+	size_t k;
+	for (k = 0; k < n / 2; k++) {
+		const double a = 2.0 * M_PI * k / n;
+		wr[k] = -0.5 * sin(a);
+		wi[k] = -0.5 * cos(a);
+	}
+}
+
+static void fft_r4_init_twiddles(struct fft_r4* plan)
+{
+	size_t L, p;
+	FLOAT* tw = plan->tw;
+
+	for (L = plan->m; L >= 4; L /= 4) {
+		const size_t q4 = L / 4;
+		for (p = 0; p < q4; p++) {
+			const double a = -2.0 * M_PI * p / L;
+			tw[q4 * 0 + p] = cos(a);
+			tw[q4 * 1 + p] = sin(a);
+			tw[q4 * 2 + p] = cos(2.0 * a);
+			tw[q4 * 3 + p] = sin(2.0 * a);
+			tw[q4 * 4 + p] = cos(3.0 * a);
+			tw[q4 * 5 + p] = sin(3.0 * a);
+		}
+		tw += q4 * 6;
+	}
+}
+
+static struct fft_r4* fft_r4_alloc_plan(size_t m, size_t n)
+{
+	size_t L;
+	size_t tw_size = 0;
+	struct fft_r4* plan;
+
+	plan = malloc(sizeof(struct fft_r4));
+	if (!plan)
+		return NULL;
+
+	plan->n = n;
+	plan->m = m;
+	plan->post_re = NULL;
+	plan->post_im = NULL;
+
+	for (L = m; L >= 4; L /= 4)
+		tw_size += (L / 4) * 6;
+
+	plan->tw = malloc(sizeof(FLOAT) * tw_size);
+	if (!plan->tw)
+		goto exit_free_plan;
+
+	if (n) {
+		plan->post_re = malloc(sizeof(FLOAT) * m * 2);
+		if (!plan->post_re)
+			goto exit_free_tw;
+		plan->post_im = plan->post_re + m;
+		fft_r4_init_post(plan->post_re, plan->post_im, n);
+	}
+
+	plan->buf = malloc(sizeof(FLOAT) * m * 4);
+	if (!plan->buf)
+		goto exit_free_post;
+
+	fft_r4_init_twiddles(plan);
+
+	return plan;
+exit_free_post:
+	free(plan->post_re);
+exit_free_tw:
+	free(plan->tw);
+exit_free_plan:
+	free(plan);
+	return NULL;
+}
+
+struct fft_r4* fft_r4_alloc(size_t n)
+{
+	if (!fft_r4_supported(n))
+		return NULL;
+
+	return fft_r4_alloc_plan(n / 2, n);
+}
+
+struct fft_r4* fft_r4_alloc_cpx(size_t m)
+{
+	if (!fft_r4_cpx_supported(m))
+		return NULL;
+
+	return fft_r4_alloc_plan(m, 0);
+}
+
+void fft_r4_free(struct fft_r4* plan)
+{
+	free(plan->buf);
+	free(plan->post_re);
+	free(plan->tw);
+	free(plan);
+}
+
+static inline void r4_bfly_v(const vr_t* ar, const vr_t* ai, const vr_t* w, vr_t* yr, vr_t* yi)
+{
+	const vr_t apcr = vr_add(ar[0], ar[2]);
+	const vr_t apci = vr_add(ai[0], ai[2]);
+	const vr_t amcr = vr_sub(ar[0], ar[2]);
+	const vr_t amci = vr_sub(ai[0], ai[2]);
+	const vr_t bpdr = vr_add(ar[1], ar[3]);
+	const vr_t bpdi = vr_add(ai[1], ai[3]);
+	const vr_t bmdr = vr_sub(ar[1], ar[3]);
+	const vr_t bmdi = vr_sub(ai[1], ai[3]);
+
+	yr[0] = vr_add(apcr, bpdr);
+	yi[0] = vr_add(apci, bpdi);
+	vr_cmul(vr_add(amcr, bmdi), vr_sub(amci, bmdr), w[0], w[1], &yr[1], &yi[1]);
+	vr_cmul(vr_sub(apcr, bpdr), vr_sub(apci, bpdi), w[2], w[3], &yr[2], &yi[2]);
+	vr_cmul(vr_sub(amcr, bmdi), vr_add(amci, bmdr), w[4], w[5], &yr[3], &yi[3]);
+}
+
+static inline void r4_bfly_s(const FLOAT* ar, const FLOAT* ai, const FLOAT* w, FLOAT* yr, FLOAT* yi)
+{
+	const FLOAT apcr = ar[0] + ar[2];
+	const FLOAT apci = ai[0] + ai[2];
+	const FLOAT amcr = ar[0] - ar[2];
+	const FLOAT amci = ai[0] - ai[2];
+	const FLOAT bpdr = ar[1] + ar[3];
+	const FLOAT bpdi = ai[1] + ai[3];
+	const FLOAT bmdr = ar[1] - ar[3];
+	const FLOAT bmdi = ai[1] - ai[3];
+	FLOAT tr, ti;
+
+	yr[0] = apcr + bpdr;
+	yi[0] = apci + bpdi;
+
+	tr = amcr + bmdi;
+	ti = amci - bmdr;
+	yr[1] = tr * w[0] - ti * w[1];
+	yi[1] = tr * w[1] + ti * w[0];
+
+	tr = apcr - bpdr;
+	ti = apci - bpdi;
+	yr[2] = tr * w[2] - ti * w[3];
+	yi[2] = tr * w[3] + ti * w[2];
+
+	tr = amcr - bmdi;
+	ti = amci + bmdr;
+	yr[3] = tr * w[4] - ti * w[5];
+	yi[3] = tr * w[5] + ti * w[4];
+}
+
+/*
+ * First stage (L = m, s = 1) reads packed real input directly:
+ * z[k] = x[2k] + i * x[2k + 1]. Requires m / 4 to be multiple of VR_LANES.
+ */
+static void r4_stage_real(const FLOAT* x, FLOAT* yr, FLOAT* yi, size_t m, const FLOAT* tw)
+{
+	const size_t q4 = m / 4;
+	size_t p, j;
+
+	for (p = 0; p < q4; p += VR_LANES) {
+		vr_t ar[4], ai[4], w[6], cr[4], ci[4], t[4];
+		for (j = 0; j < 4; j++) {
+			const FLOAT* src = x + 2 * (p + j * q4);
+			vr_deinterleave2(vr_load(src), vr_load(src + VR_LANES), &ar[j], &ai[j]);
+		}
+		for (j = 0; j < 6; j++)
+			w[j] = vr_load(tw + q4 * j + p);
+
+		r4_bfly_v(ar, ai, w, cr, ci);
+
+		vr_interleave4(cr[0], cr[1], cr[2], cr[3], t);
+		for (j = 0; j < 4; j++)
+			vr_store(yr + 4 * p + j * VR_LANES, t[j]);
+		vr_interleave4(ci[0], ci[1], ci[2], ci[3], t);
+		for (j = 0; j < 4; j++)
+			vr_store(yi + 4 * p + j * VR_LANES, t[j]);
+	}
+}
+
+/*
+ * First stage of batched transform, input is lane interleaved real data
+ */
+static void r4_stage_batch_real(const FLOAT* x, FLOAT* yr, FLOAT* yi, size_t m, const FLOAT* tw)
+{
+	const size_t q4 = m / 4;
+	size_t p, j;
+
+	for (p = 0; p < q4; p++) {
+		vr_t ar[4], ai[4], w[6], cr[4], ci[4];
+		for (j = 0; j < 4; j++) {
+			const size_t e = p + j * q4;
+			ar[j] = vr_load(x + 2 * e * VR_LANES);
+			ai[j] = vr_load(x + (2 * e + 1) * VR_LANES);
+		}
+		for (j = 0; j < 6; j++)
+			w[j] = vr_set1(tw[q4 * j + p]);
+
+		r4_bfly_v(ar, ai, w, cr, ci);
+
+		for (j = 0; j < 4; j++) {
+			vr_store(yr + (4 * p + j) * VR_LANES, cr[j]);
+			vr_store(yi + (4 * p + j) * VR_LANES, ci[j]);
+		}
+	}
+}
+
+static void r4_stage(const FLOAT* xr, const FLOAT* xi, FLOAT* yr, FLOAT* yi, size_t L, size_t s, const FLOAT* tw)
+{
+	const size_t q4 = L / 4;
+	const size_t d = q4 * s;
+	size_t p, q, j;
+
+	if (s >= VR_LANES) {
+		for (p = 0; p < q4; p++) {
+			vr_t w[6];
+			for (j = 0; j < 6; j++)
+				w[j] = vr_set1(tw[q4 * j + p]);
+
+			for (q = 0; q < s; q += VR_LANES) {
+				vr_t ar[4], ai[4], cr[4], ci[4];
+				const size_t src = q + s * p;
+				const size_t dst = q + s * 4 * p;
+				for (j = 0; j < 4; j++) {
+					ar[j] = vr_load(xr + src + j * d);
+					ai[j] = vr_load(xi + src + j * d);
+				}
+
+				r4_bfly_v(ar, ai, w, cr, ci);
+
+				for (j = 0; j < 4; j++) {
+					vr_store(yr + dst + j * s, cr[j]);
+					vr_store(yi + dst + j * s, ci[j]);
+				}
+			}
+		}
+	} else if (s == 1 && q4 % VR_LANES == 0) {
+		for (p = 0; p < q4; p += VR_LANES) {
+			vr_t ar[4], ai[4], w[6], cr[4], ci[4], t[4];
+			for (j = 0; j < 4; j++) {
+				ar[j] = vr_load(xr + p + j * d);
+				ai[j] = vr_load(xi + p + j * d);
+			}
+			for (j = 0; j < 6; j++)
+				w[j] = vr_load(tw + q4 * j + p);
+
+			r4_bfly_v(ar, ai, w, cr, ci);
+
+			vr_interleave4(cr[0], cr[1], cr[2], cr[3], t);
+			for (j = 0; j < 4; j++)
+				vr_store(yr + 4 * p + j * VR_LANES, t[j]);
+			vr_interleave4(ci[0], ci[1], ci[2], ci[3], t);
+			for (j = 0; j < 4; j++)
+				vr_store(yi + 4 * p + j * VR_LANES, t[j]);
+		}
+#if VR_LANES == 8
+	} else if (s == VR_LANES / 2 && q4 % 2 == 0) {
+		/* low half of lanes is p, high half is p + 1 */
+		for (p = 0; p < q4; p += 2) {
+			vr_t ar[4], ai[4], w[6], cr[4], ci[4], t[4];
+			for (j = 0; j < 4; j++) {
+				ar[j] = vr_load(xr + s * p + j * d);
+				ai[j] = vr_load(xi + s * p + j * d);
+			}
+			for (j = 0; j < 6; j++)
+				w[j] = vr_set1_halves(tw[q4 * j + p], tw[q4 * j + p + 1]);
+
+			r4_bfly_v(ar, ai, w, cr, ci);
+
+			vr_interleave_halves(cr[0], cr[1], cr[2], cr[3], t);
+			for (j = 0; j < 4; j++)
+				vr_store(yr + s * 4 * p + j * VR_LANES, t[j]);
+			vr_interleave_halves(ci[0], ci[1], ci[2], ci[3], t);
+			for (j = 0; j < 4; j++)
+				vr_store(yi + s * 4 * p + j * VR_LANES, t[j]);
+		}
+#endif
+	} else {
+		for (p = 0; p < q4; p++) {
+			FLOAT w[6];
+			for (j = 0; j < 6; j++)
+				w[j] = tw[q4 * j + p];
+
+			for (q = 0; q < s; q++) {
+				FLOAT ar[4], ai[4], cr[4], ci[4];
+				const size_t src = q + s * p;
+				const size_t dst = q + s * 4 * p;
+				for (j = 0; j < 4; j++) {
+					ar[j] = xr[src + j * d];
+					ai[j] = xi[src + j * d];
+				}
+
+				r4_bfly_s(ar, ai, w, cr, ci);
+
+				for (j = 0; j < 4; j++) {
+					yr[dst + j * s] = cr[j];
+					yi[dst + j * s] = ci[j];
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Last stage for odd power of two, L = 2, all twiddles are 1
+ */
+static void r2_stage(const FLOAT* xr, const FLOAT* xi, FLOAT* yr, FLOAT* yi, size_t s)
+{
+	size_t q = 0;
+
+	for (; q + VR_LANES <= s; q += VR_LANES) {
+		const vr_t ar = vr_load(xr + q);
+		const vr_t ai = vr_load(xi + q);
+		const vr_t br = vr_load(xr + q + s);
+		const vr_t bi = vr_load(xi + q + s);
+		vr_store(yr + q, vr_add(ar, br));
+		vr_store(yi + q, vr_add(ai, bi));
+		vr_store(yr + q + s, vr_sub(ar, br));
+		vr_store(yi + q + s, vr_sub(ai, bi));
+	}
+
+	for (; q < s; q++) {
+		const FLOAT ar = xr[q];
+		const FLOAT ai = xi[q];
+		const FLOAT br = xr[q + s];
+		const FLOAT bi = xi[q + s];
+		yr[q] = ar + br;
+		yi[q] = ai + bi;
+		yr[q + s] = ar - br;
+		yi[q + s] = ai - bi;
+	}
+}
+
+/*
+ * X[k] = (Z[k] + Z*[m - k]) / 2 - i/2 * W^k * (Z[k] - Z*[m - k])
+ */
+void fft_r4_post(const FLOAT* zr, const FLOAT* zi, size_t m, const FLOAT* wr, const FLOAT* wi, kiss_fft_cpx* cpx)
+{
+	size_t k = 1;
+	FLOAT* out = (FLOAT*)cpx;
+	const vr_t half = vr_set1(0.5);
+
+	out[0] = zr[0] + zi[0];
+	out[1] = 0;
+	out[2 * m] = zr[0] - zi[0];
+	out[2 * m + 1] = 0;
+
+	for (; k + VR_LANES <= m; k += VR_LANES) {
+		const size_t j = m - k - VR_LANES + 1;
+		const vr_t fr = vr_load(zr + k);
+		const vr_t fi = vr_load(zi + k);
+		const vr_t gr = vr_reverse(vr_load(zr + j));
+		const vr_t gi = vr_reverse(vr_load(zi + j));
+		const vr_t er = vr_mul(half, vr_add(fr, gr));
+		const vr_t ei = vr_mul(half, vr_sub(fi, gi));
+		vr_t xr, xi, lo, hi;
+
+		vr_cmul(vr_sub(fr, gr), vr_add(fi, gi), vr_load(wr + k), vr_load(wi + k), &xr, &xi);
+		vr_interleave2(vr_add(er, xr), vr_add(ei, xi), &lo, &hi);
+		vr_store(out + 2 * k, lo);
+		vr_store(out + 2 * k + VR_LANES, hi);
+	}
+
+	for (; k < m; k++) {
+		const FLOAT fr = zr[k];
+		const FLOAT fi = zi[k];
+		const FLOAT gr = zr[m - k];
+		const FLOAT gi = zi[m - k];
+		const FLOAT dr = fr - gr;
+		const FLOAT di = fi + gi;
+		out[2 * k] = 0.5 * (fr + gr) + dr * wr[k] - di * wi[k];
+		out[2 * k + 1] = 0.5 * (fi - gi) + dr * wi[k] + di * wr[k];
+	}
+}
+
+static void r4_post_batch(const FLOAT* zr, const FLOAT* zi, size_t m, const FLOAT* wr, const FLOAT* wi, FLOAT* out_re, FLOAT* out_im)
+{
+	size_t k;
+	const vr_t half = vr_set1(0.5);
+	const vr_t zero = vr_zero();
+	const vr_t r0 = vr_load(zr);
+	const vr_t i0 = vr_load(zi);
+
+	vr_store(out_re, vr_add(r0, i0));
+	vr_store(out_im, zero);
+	vr_store(out_re + m * VR_LANES, vr_sub(r0, i0));
+	vr_store(out_im + m * VR_LANES, zero);
+
+	for (k = 1; k < m; k++) {
+		const vr_t fr = vr_load(zr + k * VR_LANES);
+		const vr_t fi = vr_load(zi + k * VR_LANES);
+		const vr_t gr = vr_load(zr + (m - k) * VR_LANES);
+		const vr_t gi = vr_load(zi + (m - k) * VR_LANES);
+		vr_t xr, xi;
+
+		vr_cmul(vr_sub(fr, gr), vr_add(fi, gi), vr_set1(wr[k]), vr_set1(wi[k]), &xr, &xi);
+		vr_store(out_re + k * VR_LANES, vr_add(vr_mul(half, vr_add(fr, gr)), xr));
+		vr_store(out_im + k * VR_LANES, vr_add(vr_mul(half, vr_sub(fi, gi)), xi));
+	}
+}
+
+void fft_r4_real(struct fft_r4* plan, const FLOAT* in, kiss_fft_cpx* out)
+{
+	const size_t m = plan->m;
+	const FLOAT* tw = plan->tw;
+	FLOAT* xr = plan->buf;
+	FLOAT* xi = xr + m;
+	FLOAT* yr = xi + m;
+	FLOAT* yi = yr + m;
+	FLOAT* t;
+	size_t L = m / 4;
+	size_t s = 4;
+
+	r4_stage_real(in, xr, xi, m, tw);
+	tw += m / 4 * 6;
+
+	for (; L >= 4; L /= 4, s *= 4) {
+		r4_stage(xr, xi, yr, yi, L, s, tw);
+		tw += L / 4 * 6;
+		t = xr; xr = yr; yr = t;
+		t = xi; xi = yi; yi = t;
+	}
+
+	if (L == 2) {
+		r2_stage(xr, xi, yr, yi, s);
+		xr = yr;
+		xi = yi;
+	}
+
+	fft_r4_post(xr, xi, m, plan->post_re, plan->post_im, out);
+}
+
+void fft_r4_cpx(struct fft_r4* plan, FLOAT* re, FLOAT* im)
+{
+	const size_t m = plan->m;
+	const FLOAT* tw = plan->tw;
+	FLOAT* xr = re;
+	FLOAT* xi = im;
+	FLOAT* yr = plan->buf;
+	FLOAT* yi = yr + m;
+	FLOAT* t;
+	size_t L = m;
+	size_t s = 1;
+
+	for (; L >= 4; L /= 4, s *= 4) {
+		r4_stage(xr, xi, yr, yi, L, s, tw);
+		tw += L / 4 * 6;
+		t = xr; xr = yr; yr = t;
+		t = xi; xi = yi; yi = t;
+	}
+
+	if (L == 2) {
+		r2_stage(xr, xi, yr, yi, s);
+		t = xr; xr = yr; yr = t;
+		t = xi; xi = yi; yi = t;
+	}
+
+	if (xr != re) {
+		memcpy(re, xr, sizeof(FLOAT) * m);
+		memcpy(im, xi, sizeof(FLOAT) * m);
+	}
+}
+
+size_t fft_r4_batch_lanes(void)
+{
+	return VR_LANES;
+}
+
+void fft_r4_real_batch(struct fft_r4* plan, const FLOAT* in, FLOAT* out_re, FLOAT* out_im, FLOAT* work)
+{
+	const size_t m = plan->m;
+	const FLOAT* tw = plan->tw;
+	FLOAT* xr = work;
+	FLOAT* xi = xr + m * VR_LANES;
+	FLOAT* yr = xi + m * VR_LANES;
+	FLOAT* yi = yr + m * VR_LANES;
+	FLOAT* t;
+	size_t L = m / 4;
+	size_t s = 4;
+
+	/* Stockham stage with stride s * VR_LANES processes VR_LANES interleaved transforms */
+	r4_stage_batch_real(in, xr, xi, m, tw);
+	tw += m / 4 * 6;
+
+	for (; L >= 4; L /= 4, s *= 4) {
+		r4_stage(xr, xi, yr, yi, L, s * VR_LANES, tw);
+		tw += L / 4 * 6;
+		t = xr; xr = yr; yr = t;
+		t = xi; xi = yi; yi = t;
+	}
+
+	if (L == 2) {
+		r2_stage(xr, xi, yr, yi, s * VR_LANES);
+		xr = yr;
+		xi = yi;
+	}
+
+	r4_post_batch(xr, xi, m, plan->post_re, plan->post_im, out_re, out_im);
+}
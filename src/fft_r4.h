@@ -0,0 +1,76 @@
+#ifndef FFT_R4_H
+#define FFT_R4_H
+
+#include "isa.h"
+
+#include <include/libgha.h>
+
+#include <kiss_fft.h>
+
+/*
+ * Radix-4 Stockham FFT for power of two sizes.
+ *
+ * Real input of size n is packed as n/2 complex points, transformed
+ * with radix-4 (and one final radix-2 if needed) butterflies on split
+ * real/imaginary arrays and converted to the n/2 + 1 output bins.
+ * Output format is the same as kiss_fftr one (unscaled, kiss_fft_cpx).
+ */
+
+#define FFT_R4_MIN_SIZE 64
+
+struct fft_r4;
+
+/*
+ * Returns not zero if given real size can be handled by this implementation
+ */
+int fft_r4_supported(size_t n);
+
+/*
+ * n - real fft size
+ * returns null in case of fail
+ */
+struct fft_r4* fft_r4_alloc(size_t n);
+
+void fft_r4_free(struct fft_r4* plan);
+
+/*
+ * in - n real samples, out - n/2 + 1 complex bins
+ */
+void fft_r4_real(struct fft_r4* plan, const FLOAT* in, kiss_fft_cpx* out);
+
+/*
+ * Batched transform of fft_r4_batch_lanes() frames at once, one frame per SIMD lane.
+ *
+ * in - lane interleaved real input, in[i * lanes + l] is sample i of frame l
+ * out_re, out_im - lane interleaved (n/2 + 1) * lanes bins
+ * work - 2 * n * lanes values
+ */
+size_t fft_r4_batch_lanes(void);
+
+void fft_r4_real_batch(struct fft_r4* plan, const FLOAT* in, FLOAT* out_re, FLOAT* out_im, FLOAT* work);
+
+/*
+ * Complex plan, m - complex fft size
+ */
+int fft_r4_cpx_supported(size_t m);
+
+struct fft_r4* fft_r4_alloc_cpx(size_t m);
+
+/*
+ * In place forward transform of m points given as split re/im arrays
+ */
+void fft_r4_cpx(struct fft_r4* plan, FLOAT* re, FLOAT* im);
+
+/*
+ * Real post processing helpers, can be used to build real transform
+ * of size n = 2 * m from any complex transform Z of packed input
+ * z[k] = x[2k] + i * x[2k + 1].
+ *
+ * fft_r4_init_post fills n/2 twiddles for real size n,
+ * fft_r4_post writes m + 1 output bins.
+ */
+void fft_r4_init_post(FLOAT* wr, FLOAT* wi, size_t n);
+
+void fft_r4_post(const FLOAT* zr, const FLOAT* zi, size_t m, const FLOAT* wr, const FLOAT* wi, kiss_fft_cpx* out);
+
+#endif
@@ -0,0 +1,105 @@
+#include "frame.h"
+#include "batch.h"
+#include "simd.h"
+
+#include <math.h>
+
+void frame_window(const FLOAT* pcm, const FLOAT* window, size_t size, FLOAT* out)
+{
+	size_t i;
+
+	for (i = 0; i + VR_LANES <= size; i += VR_LANES)
+		vr_store(out + i, vr_mul(vr_load(pcm + i), vr_load(window + i)));
+
+	for (; i < size; i++)
+		out[i] = pcm[i] * window[i];
+}
+
+/*
+ * Perform search of frequency using Newton's method
+ * Also we calculate real and imaginary part of Fourier transform at target frequency
+ * so we also calculate phase here at last iteration
+ */
+void frame_newton(const FLOAT* pcm, double omega_rad, size_t size,
+	double omega_min, double omega_max, size_t max_loops, struct gha_info* result)
+{
+	size_t loop;
+	int n;
+	int edge = 0;
+
+	for (loop = 0; loop <= max_loops; loop++) {
+		double Xr = 0;
+		double Xi = 0;
+		double dXr = 0;
+		double dXi = 0;
+		double ddXr = 0;
+		double ddXs = 0;
+
+		const double a = cos(omega_rad);
+		const double b = sin(omega_rad);
+		double c = 1.0;
+		double s = 0.0;
+
+		for (n = 0; n < size; n++) {
+			double cm = pcm[n] * c;
+			double sm = pcm[n] * s;
+			double tc, ts;
+			Xr += cm;
+			Xi += sm;
+			tc = n * cm;
+			ts = n * sm;
+			dXr -= ts;
+			dXi += tc;
+			ddXr -= n * tc;
+			ddXs -= n * ts;
+
+			const double new_c = a * c - b * s;
+			const double new_s = b * c + a * s;
+			c = new_c;
+			s = new_s;
+
+
+		}
+
+		double F = Xr * dXr + Xi * dXi;
+		double G2 = Xr * Xr + Xi * Xi;
+		//fprintf(stderr, " %f %f \n", Xr, Xi);
+		//double dXg = F;
+		double dF = Xr * ddXr + dXr * dXr + Xi * ddXs + dXi * dXi;
+
+		//double dg = F / G;
+		//double ddXg = (dF * G - F * dg) / G;
+		//double dw = dXg / ddXg;
+		double dw = newton_step(F, dF, G2);
+		//fprintf(stderr, "dw: %f\n", dw);
+
+		if (newton_update(dw, omega_min, omega_max, loop == max_loops, &omega_rad, &edge, &Xr, &Xi, dXr, dXi)) {
+			result->frequency = omega_rad;
+			/* assume zero phase sine */
+			result->phase = newton_phase(Xr, Xi);
+			break;
+		}
+	}
+}
+
+void frame_sine(FLOAT* buf, size_t size, FLOAT omega, FLOAT phase)
+{
+	int i;
+	for (i = 0; i < size; i++) {
+		buf[i] = sin(omega * i + phase);
+	}
+}
+
+double frame_fit(const FLOAT* x, const FLOAT* sine, size_t size)
+{
+	int i;
+	double t1 = 0;
+	double t2 = 0;
+	for (i = 0; i < size; i++) {
+		t1 += x[i] * sine[i];
+		t2 += sine[i] * sine[i];
+	}
+
+	/* zero sine (frequency and phase 0) fits nothing */
+	return t2 > 0 ? t1 / t2 : 0;
+}
@@ -0,0 +1,35 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "isa.h"
+
+#include <include/libgha.h>
+
+/*
+ * Per frame kernels of single frame analysis.
+ */
+
+/*
+ * out[i] = pcm[i] * window[i]
+ */
+void frame_window(const FLOAT* pcm, const FLOAT* window, size_t size, FLOAT* out);
+
+/*
+ * Newton search of the frequency maximizing transform magnitude of windowed
+ * frame x starting from omega, kept in [omega_min, omega_max]. Frequency and
+ * phase of zero phase sine are written in to result, magnitude is not touched.
+ */
+void frame_newton(const FLOAT* x, double omega, size_t size, double omega_min, double omega_max,
+	size_t max_loops, struct gha_info* result);
+
+/*
+ * buf[i] = sin(omega * i + phase)
+ */
+void frame_sine(FLOAT* buf, size_t size, FLOAT omega, FLOAT phase);
+
+/*
+ * Least squares magnitude of sine in x, 0 for zero sine
+ */
+double frame_fit(const FLOAT* x, const FLOAT* sine, size_t size);
+
+#endif
@@ -2,81 +2,410 @@
 
 #include <include/libgha.h> 
 
-#include <tools/kiss_fftr.h>
+#include "kernels.h"
+#include "decimate.h"
+#include "analysis.h"
+#include "window.h"
 
 /*
  * Ref: http://www.apsipa.org/proceedings_2009/pdf/WA-L3-3.pdf
  */
 
+/* decimation filter half length per decimation factor */
+#define GHA_DEC_HALF_TAPS 6
+/* min number of samples of decimated frame */
+#define GHA_DEC_MIN_SIZE 64
+/* number of blocks the frame is summed in to for zoom stage */
+#define GHA_ZOOM_BLOCKS 64
+/* fft bins on each side of the peak used to interpolate spectrum for spectral refinement */
+#define GHA_SPECTRAL_BINS 16
+/* finite difference step of spectral Newton search, fft bins */
+#define GHA_SPECTRAL_STEP 0.01
+/* iterations of multidimensional Newton adjustment */
+#define GHA_ADJUST_LOOPS 7
+/* adjustment stops once magnitude (relative), phase and frequency * size steps are below it */
+#define GHA_ADJUST_TOLERANCE 1e-6
+/* max size of component group for local adjustment is this + 1 */
+#define GHA_LOCAL_MAX_NEIGHBOURS 8
+/* harmonic comb of a lower fundamental candidate has to be that much stronger */
+#define GHA_HARMONIC_MARGIN 1.25
+
 struct gha_ctx {
 	size_t size;
-	kiss_fftr_cfg fftr;
+	/* size of (possibly zero padded) frame used to estimate initial frequency */
+	size_t fft_size;
+	const struct kernels* kernels;
+	struct fft* fft;
 
 	kiss_fft_cpx* fft_out;
-	FLOAT* freq;
-	FLOAT* window;
+	/* power of fft_out bins (or dec_out ones), peak search scratch */
+	FLOAT* fft_power;
+	/* input samples converted to FLOAT */
+	FLOAT* raw_buf;
+	/* shared table of the analysis window, window points to its coefficients */
+	const struct window* win;
+	const FLOAT* window;
 
 	FLOAT* tmp_buf;
 
+	/* lane interleaved frames, spectrum and fft work buffer, allocated on first batch call */
+	FLOAT* batch_buf;
+
+	/* windowed frames and summed power spectrum for joint analysis of joint_channels channels */
+	FLOAT* joint_buf;
+	size_t joint_channels;
+	/* cos and sin of omega * n, 2 * size values */
+	double* rot_buf;
+
+	/* complex fft and its windowed input and output, allocated on first complex call */
+	struct fft* cpx_fft;
+	kiss_fft_cpx* cpx_buf;
+
+	/* analysed band, radians per sample */
+	double omega_min;
+	double omega_max;
+
+	/*
+	 * Decimation for narrow low band, disabled if dec_factor is 0: initial frequency
+	 * is estimated on the frame low pass filtered and decimated to dec_size samples
+	 */
+	size_t dec_factor;
+	size_t dec_size;
+	size_t dec_fft_size;
+	/* filter has 2 * dec_half + 1 symmetric taps */
+	size_t dec_half;
+	struct fft* dec_fft;
+	kiss_fft_cpx* dec_out;
+	/* filter taps from the center and decimated frame */
+	FLOAT* dec_buf;
+	const struct window* dec_win;
+
+	/*
+	 * Zoom stage, disabled if zoom is 0: the frame is mixed down to the peak bin and
+	 * summed in to zoom_blocks blocks of zoom_decimation samples, zoom_size point fft
+	 * of the blocks gives zoom points per bin around the peak
+	 */
+	size_t zoom;
+	size_t zoom_decimation;
+	size_t zoom_blocks;
+	size_t zoom_size;
+	struct fft* zoom_fft;
+	/* fft input and output */
+	kiss_fft_cpx* zoom_buf;
+	/* cos and sin of omega * n for n in block, 2 * zoom_decimation values */
+	double* zoom_rot;
+
+	/* frequency refinement after the fft peak search */
+	enum gha_refine refine;
+	enum gha_quality quality;
+	/* GHA_FIELD_* wanted by analysis */
+	unsigned fields;
+	/* frames with energy (sum of squares) below it have no component, 0 - off */
+	double gate;
+
 	void (*resuidal_cb)(FLOAT* resuidal, size_t size, void* user_ctx);
 	void* user_ctx;
 };
 
-static void gha_init_window(gha_ctx_t ctx)
+/*
+ * (Re)allocate FFT related buffers, previous state is kept in case of fail
+ */
+static int gha_init_fft(gha_ctx_t ctx, size_t fft_size)
 {
-	size_t i;
-	size_t n = ctx->size + 1;
-	for (i = 0; i < ctx->size; i++) {
-		ctx->window[i] = sin(M_PI * (i + 1) / n);
+	struct fft* fft;
+	kiss_fft_cpx* fft_out;
+	FLOAT* tmp_buf;
+
+	fft = ctx->kernels->fft.alloc(fft_size);
+	if (!fft)
+		return -1;
+
+	/* bins + power */
+	fft_out = malloc((sizeof(kiss_fft_cpx) + sizeof(FLOAT)) * (fft_size/2 + 1));
+	if (!fft_out)
+		goto exit_free_fft;
+
+	tmp_buf = malloc(sizeof(FLOAT) * fft_size);
+	if (!tmp_buf)
+		goto exit_free_fft_out;
+
+	if (ctx->fft) {
+		if (ctx->cpx_fft)
+			ctx->kernels->fft.free(ctx->cpx_fft);
+		free(ctx->cpx_buf);
+		free(ctx->joint_buf);
+		free(ctx->batch_buf);
+		free(ctx->tmp_buf);
+		free(ctx->fft_out);
+		ctx->kernels->fft.free(ctx->fft);
 	}
+	ctx->batch_buf = NULL;
+	ctx->joint_buf = NULL;
+	ctx->joint_channels = 0;
+	ctx->cpx_fft = NULL;
+	ctx->cpx_buf = NULL;
+
+	ctx->fft_size = fft_size;
+	ctx->fft = fft;
+	ctx->fft_out = fft_out;
+	ctx->fft_power = (FLOAT*)(fft_out + fft_size/2 + 1);
+	ctx->tmp_buf = tmp_buf;
+
+	return 0;
+exit_free_fft_out:
+	free(fft_out);
+exit_free_fft:
+	ctx->kernels->fft.free(fft);
+	return -1;
 }
 
 gha_ctx_t gha_create_ctx(size_t size)
 {
-	gha_ctx_t ctx = malloc(sizeof(struct gha_ctx));
+	gha_ctx_t ctx;
+
+	if (size == 0)
+		return NULL;
+
+	ctx = malloc(sizeof(struct gha_ctx));
 	if (!ctx)
 		return NULL;
 
 	ctx->size = size;
 	ctx->resuidal_cb = NULL;
 	ctx->user_ctx = NULL;
-
-	ctx->fftr = kiss_fftr_alloc(size, 0, NULL, NULL);
-	if (!ctx->fftr)
+	ctx->fft = NULL;
+	ctx->rot_buf = NULL;
+	ctx->omega_min = 0.0;
+	ctx->omega_max = M_PI;
+	ctx->dec_factor = 0;
+	ctx->dec_fft = NULL;
+	ctx->dec_out = NULL;
+	ctx->dec_buf = NULL;
+	ctx->dec_win = NULL;
+	ctx->zoom = 0;
+	ctx->zoom_fft = NULL;
+	ctx->zoom_buf = NULL;
+	ctx->zoom_rot = NULL;
+	ctx->refine = GHA_REFINE_TIME;
+	ctx->quality = GHA_QUALITY_FULL;
+	ctx->fields = GHA_FIELDS_ALL;
+	ctx->gate = 0;
+	ctx->kernels = kernels_select();
+
+	ctx->raw_buf = malloc(sizeof(FLOAT) * size);
+	if (!ctx->raw_buf)
 		goto exit_free_gha_ctx;
 
-	ctx->freq = malloc(sizeof(FLOAT) * size);
-	if (!ctx->freq)
-		goto exit_free_fftr_ctx;
-
-	ctx->window = malloc(sizeof(FLOAT) * size);
-	if (!ctx->window)
-		goto exit_free_freq;
+	ctx->win = window_acquire(GHA_WINDOW_SINE, 0, size);
+	if (!ctx->win)
+		goto exit_free_raw_buf;
+	ctx->window = ctx->win->coef;
 
-	ctx->tmp_buf = malloc(sizeof(FLOAT) * size);
-	if (!ctx->tmp_buf)
+	if (gha_init_fft(ctx, size))
 		goto exit_free_window;
 
-	ctx->fft_out = malloc(sizeof(kiss_fft_cpx) * (size/2 + 1));
-	if (!ctx->fft_out)
-		goto exit_free_tmp_buf;
-
-	gha_init_window(ctx);
-
 	return ctx;
-exit_free_tmp_buf:
-	free(ctx->tmp_buf);
 exit_free_window:
-	free(ctx->window);
-exit_free_freq:
-	free(ctx->freq);
-exit_free_fftr_ctx:
-	kiss_fftr_free(ctx->fftr);
+	window_release(ctx->win);
+exit_free_raw_buf:
+	free(ctx->raw_buf);
 exit_free_gha_ctx:
 	free(ctx);
 	return NULL;
 }
 
+int gha_set_fft_padding(size_t oversample, gha_ctx_t ctx)
+{
+	size_t fft_size = ctx->size;
+
+	if (oversample)
+		fft_size = ctx->kernels->fft.next_fast_size(ctx->size * oversample);
+
+	if (fft_size == ctx->fft_size)
+		return 0;
+
+	return gha_init_fft(ctx, fft_size);
+}
+
+int gha_set_band(FLOAT omega_min, FLOAT omega_max, gha_ctx_t ctx)
+{
+	size_t factor, half = 0, dec_size = 0, dec_fft_size = 0;
+	struct fft* dec_fft = NULL;
+	kiss_fft_cpx* dec_out = NULL;
+	FLOAT* dec_buf = NULL;
+	const struct window* dec_win = NULL;
+
+	if (!(omega_min >= 0 && omega_min < omega_max && omega_max <= (FLOAT)M_PI))
+		return -1;
+
+	/*
+	 * The band should be below a quarter of decimated rate, so the filter
+	 * transition fits between the band and its aliases
+	 */
+	factor = ctx->size / GHA_DEC_MIN_SIZE;
+	if (factor > M_PI / (2 * omega_max) + 1e-6)
+		factor = M_PI / (2 * omega_max) + 1e-6;
+
+	for (; factor >= 2; factor--) {
+		half = GHA_DEC_HALF_TAPS * factor;
+		dec_size = decimate_size(ctx->size, half, factor);
+		if (dec_size >= GHA_DEC_MIN_SIZE)
+			break;
+	}
+
+	if (factor >= 2) {
+		dec_fft_size = ctx->kernels->fft.next_fast_size(dec_size);
+
+		dec_fft = ctx->kernels->fft.alloc(dec_fft_size);
+		if (!dec_fft)
+			return -1;
+
+		dec_out = malloc(sizeof(kiss_fft_cpx) * (dec_fft_size/2 + 1));
+		if (!dec_out)
+			goto exit_free_dec_fft;
+
+		/* taps + frame */
+		dec_buf = malloc(sizeof(FLOAT) * (half + 1 + dec_fft_size));
+		if (!dec_buf)
+			goto exit_free_dec_out;
+
+		dec_win = window_acquire(ctx->win->type, ctx->win->param, dec_size);
+		if (!dec_win)
+			goto exit_free_dec_buf;
+
+		decimate_filter(dec_buf, half, factor);
+	} else {
+		factor = 0;
+	}
+
+	if (ctx->dec_fft)
+		ctx->kernels->fft.free(ctx->dec_fft);
+	free(ctx->dec_out);
+	free(ctx->dec_buf);
+	if (ctx->dec_win)
+		window_release(ctx->dec_win);
+
+	ctx->dec_factor = factor;
+	ctx->dec_size = dec_size;
+	ctx->dec_fft_size = dec_fft_size;
+	ctx->dec_half = half;
+	ctx->dec_fft = dec_fft;
+	ctx->dec_out = dec_out;
+	ctx->dec_buf = dec_buf;
+	ctx->dec_win = dec_win;
+
+	ctx->omega_min = omega_min;
+	/* pi rounded to FLOAT may be above pi */
+	ctx->omega_max = omega_max < M_PI ? omega_max : M_PI;
+
+	return 0;
+exit_free_dec_buf:
+	free(dec_buf);
+exit_free_dec_out:
+	free(dec_out);
+exit_free_dec_fft:
+	ctx->kernels->fft.free(dec_fft);
+	return -1;
+}
+
+int gha_set_window(enum gha_window type, FLOAT param, gha_ctx_t ctx)
+{
+	const struct window* win;
+	const struct window* dec_win = NULL;
+
+	win = window_acquire(type, param, ctx->size);
+	if (!win)
+		return -1;
+
+	if (ctx->dec_factor) {
+		dec_win = window_acquire(type, param, ctx->dec_size);
+		if (!dec_win) {
+			window_release(win);
+			return -1;
+		}
+		window_release(ctx->dec_win);
+		ctx->dec_win = dec_win;
+	}
+
+	window_release(ctx->win);
+	ctx->win = win;
+	ctx->window = win->coef;
+
+	return 0;
+}
+
+int gha_set_zoom(size_t zoom, gha_ctx_t ctx)
+{
+	size_t decimation = 0, blocks = 0, zoom_size = 0;
+	struct fft* zoom_fft = NULL;
+	kiss_fft_cpx* zoom_buf = NULL;
+	double* zoom_rot = NULL;
+
+	if (zoom && ctx->size >= GHA_ZOOM_BLOCKS) {
+		decimation = ctx->size / GHA_ZOOM_BLOCKS;
+		blocks = (ctx->size + decimation - 1) / decimation;
+		zoom_size = ctx->kernels->fft.next_fast_size(blocks * zoom);
+
+		zoom_fft = ctx->kernels->fft.alloc_cpx(zoom_size);
+		if (!zoom_fft)
+			return -1;
+
+		zoom_buf = malloc(sizeof(kiss_fft_cpx) * zoom_size * 2);
+		if (!zoom_buf)
+			goto exit_free_zoom_fft;
+
+		zoom_rot = malloc(sizeof(double) * decimation * 2);
+		if (!zoom_rot)
+			goto exit_free_zoom_buf;
+	} else {
+		zoom = 0;
+	}
+
+	if (ctx->zoom_fft)
+		ctx->kernels->fft.free(ctx->zoom_fft);
+	free(ctx->zoom_buf);
+	free(ctx->zoom_rot);
+
+	ctx->zoom = zoom;
+	ctx->zoom_decimation = decimation;
+	ctx->zoom_blocks = blocks;
+	ctx->zoom_size = zoom_size;
+	ctx->zoom_fft = zoom_fft;
+	ctx->zoom_buf = zoom_buf;
+	ctx->zoom_rot = zoom_rot;
+
+	return 0;
+exit_free_zoom_buf:
+	free(zoom_buf);
+exit_free_zoom_fft:
+	ctx->kernels->fft.free(zoom_fft);
+	return -1;
+}
+
+void gha_set_refine(enum gha_refine refine, gha_ctx_t ctx)
+{
+	ctx->refine = refine;
+}
+
+void gha_set_quality(enum gha_quality quality, gha_ctx_t ctx)
+{
+	ctx->quality = quality;
+}
+
+void gha_set_fields(unsigned fields, gha_ctx_t ctx)
+{
+	ctx->fields = fields | GHA_FIELD_FREQUENCY;
+}
+
+int gha_set_energy_gate(FLOAT level, gha_ctx_t ctx)
+{
+	if (level < 0)
+		return -1;
+
+	ctx->gate = (double)level * level * ctx->size;
+	return 0;
+}
+
 void gha_set_user_resuidal_cb(void (*cb)(FLOAT* resuidal, size_t size, void* user_ctx), void* user_ctx, gha_ctx_t ctx)
 {
 	ctx->user_ctx = user_ctx;
@@ -85,50 +414,175 @@ void gha_set_user_resuidal_cb(void (*cb)(FLOAT* resuidal, size_t size, void* use
 
 void gha_free_ctx(gha_ctx_t ctx)
 {
+	if (ctx->zoom_fft)
+		ctx->kernels->fft.free(ctx->zoom_fft);
+	free(ctx->zoom_buf);
+	free(ctx->zoom_rot);
+	if (ctx->dec_fft)
+		ctx->kernels->fft.free(ctx->dec_fft);
+	free(ctx->dec_out);
+	free(ctx->dec_buf);
+	if (ctx->dec_win)
+		window_release(ctx->dec_win);
+	if (ctx->cpx_fft)
+		ctx->kernels->fft.free(ctx->cpx_fft);
+	free(ctx->cpx_buf);
+	free(ctx->rot_buf);
+	free(ctx->joint_buf);
+	free(ctx->batch_buf);
 	free(ctx->fft_out);
 	free(ctx->tmp_buf);
-	free(ctx->window);
-	free(ctx->freq);
-	kiss_fft_free(ctx->fftr);
+	window_release(ctx->win);
+	free(ctx->raw_buf);
+	ctx->kernels->fft.free(ctx->fft);
 	free(ctx);
 }
 
-static size_t gha_estimate_bin(gha_ctx_t ctx)
+/*
+ * Bins of fft of fft_size covering the band scaled by factor
+ */
+static void gha_band_bins(gha_ctx_t ctx, size_t fft_size, size_t factor, size_t* first, size_t* last)
 {
-	size_t i, end;
-	size_t j = 0;
-	FLOAT max = 0.0;
-	FLOAT tmp = 0.0;
-	end = ctx->size/2 + 1;
-	for (i = 0; i < end; i++) {
-		tmp = ctx->fft_out[i].r * ctx->fft_out[i].r + ctx->fft_out[i].i * ctx->fft_out[i].i;
-		if (tmp > max) {
-			max = tmp;
-			j = i;
+	const double scale = factor * fft_size / (2 * M_PI);
+	const size_t end = fft_size/2;
+
+	*first = floor(ctx->omega_min * scale);
+	*last = ceil(ctx->omega_max * scale);
+	if (*last > end)
+		*last = end;
+	if (*first > *last)
+		*first = *last;
+}
+
+/*
+ * Bin with max power in [first, last], the first one if there are several
+ */
+static size_t gha_estimate_bin(const kiss_fft_cpx* out, size_t first, size_t last, gha_ctx_t ctx)
+{
+	size_t j = first;
+	FLOAT max;
+
+	ctx->kernels->peaks.find(out, first, last, -1.0, NULL, 1, ctx->fft_power, &j, &max);
+
+	return j;
+}
+
+/*
+ * cos(omega * n) and sin(omega * n) for n in [0, size) using rotation
+ */
+static void gha_generate_rotation(double* c, double* s, size_t size, double omega_rad)
+{
+	size_t n;
+	const double a = cos(omega_rad);
+	const double b = sin(omega_rad);
+	double cn = 1.0;
+	double sn = 0.0;
+
+	for (n = 0; n < size; n++) {
+		const double new_c = a * cn - b * sn;
+		const double new_s = b * cn + a * sn;
+		c[n] = cn;
+		s[n] = sn;
+		cn = new_c;
+		sn = new_s;
+	}
+}
+
+/*
+ * Newton search of frequency common for channels frames, frame of channel ch
+ * is pcm + ch * stride. The objective is the sum of the channels power
+ * at target frequency, phase is calculated for each channel.
+ */
+static void gha_search_omega_newton_joint(const FLOAT* pcm, size_t stride, size_t channels, double omega_rad,
+	size_t size, double omega_min, double omega_max, double* rot, struct gha_info* result)
+{
+	size_t loop, ch, n;
+	int edge = 0;
+	double* c = rot;
+	double* s = rot + size;
+	double Xr[channels];
+	double Xi[channels];
+
+	for (loop = 0; loop <= NEWTON_MAX_LOOPS; loop++) {
+		double F = 0;
+		double G2 = 0;
+		double dF = 0;
+		double dw;
+		int was_edge;
+
+		gha_generate_rotation(c, s, size, omega_rad);
+
+		for (ch = 0; ch < channels; ch++) {
+			const FLOAT* x = pcm + ch * stride;
+			double xr = 0;
+			double xi = 0;
+			double dXr = 0;
+			double dXi = 0;
+			double ddXr = 0;
+			double ddXs = 0;
+
+			for (n = 0; n < size; n++) {
+				double cm = x[n] * c[n];
+				double sm = x[n] * s[n];
+				double tc = n * cm;
+				double ts = n * sm;
+				xr += cm;
+				xi += sm;
+				dXr -= ts;
+				dXi += tc;
+				ddXr -= n * tc;
+				ddXs -= n * ts;
+			}
+
+			F += xr * dXr + xi * dXi;
+			G2 += xr * xr + xi * xi;
+			dF += xr * ddXr + dXr * dXr + xi * ddXs + dXi * dXi;
+			Xr[ch] = xr;
+			Xi[ch] = xi;
+		}
+
+		dw = newton_step(F, dF, G2);
+
+		omega_rad -= dw;
+
+		if (omega_rad < 0)
+			omega_rad *= -1;
+
+		while (omega_rad > M_PI * 2.0)
+			omega_rad -= M_PI * 2.0;
+
+		if (omega_rad > M_PI)
+			omega_rad = M_PI * 2.0 - omega_rad;
+
+		was_edge = edge;
+		edge = newton_clamp(&omega_rad, omega_min, omega_max);
+
+		if (loop == NEWTON_MAX_LOOPS || fabs(dw) < NEWTON_TOLERANCE || (edge && was_edge)) {
+			for (ch = 0; ch < channels; ch++) {
+				result[ch].frequency = omega_rad;
+				result[ch].phase = newton_phase(Xr[ch], Xi[ch]);
+			}
+			break;
 		}
 	}
-	return j;
 }
 
 /*
- * Perform search of frequency using Newton's method
- * Also we calculate real and imaginary part of Fourier transform at target frequency
- * so we also calculate phase here at last iteration
+ * Newton search of frequency in (-pi, pi] for complex signal x,
+ * phase is calculated at last iteration
  */
-static void gha_search_omega_newton(const FLOAT* pcm, size_t bin, size_t size, struct gha_info* result)
+static void gha_search_omega_newton_complex(const kiss_fft_cpx* x, double omega_rad, size_t size, struct gha_info* result)
 {
 	size_t loop;
-	int n;
-	double omega_rad = bin * 2 * M_PI / size;
+	size_t n;
 
-	const size_t MAX_LOOPS = 8;
-	for (loop = 0; loop <= MAX_LOOPS; loop++) {
+	for (loop = 0; loop <= NEWTON_MAX_LOOPS; loop++) {
 		double Xr = 0;
 		double Xi = 0;
 		double dXr = 0;
 		double dXi = 0;
 		double ddXr = 0;
-		double ddXs = 0;
+		double ddXi = 0;
 
 		const double a = cos(omega_rad);
 		const double b = sin(omega_rad);
@@ -136,90 +590,55 @@ static void gha_search_omega_newton(const FLOAT* pcm, size_t bin, size_t size, s
 		double s = 0.0;
 
 		for (n = 0; n < size; n++) {
-			double cm = pcm[n] * c;
-			double sm = pcm[n] * s;
-			double tc, ts;
-			Xr += cm;
-			Xi += sm;
-			tc = n * cm;
-			ts = n * sm;
-			dXr -= ts;
-			dXi += tc;
-			ddXr -= n * tc;
-			ddXs -= n * ts;
-
+			/* x[n] * exp(-i * omega * n) */
+			const double yr = x[n].r * c + x[n].i * s;
+			const double yi = x[n].i * c - x[n].r * s;
 			const double new_c = a * c - b * s;
 			const double new_s = b * c + a * s;
+			Xr += yr;
+			Xi += yi;
+			dXr += n * yi;
+			dXi -= n * yr;
+			ddXr -= (double)n * n * yr;
+			ddXi -= (double)n * n * yi;
 			c = new_c;
 			s = new_s;
-
-
 		}
 
 		double F = Xr * dXr + Xi * dXi;
 		double G2 = Xr * Xr + Xi * Xi;
-		//fprintf(stderr, " %f %f \n", Xr, Xi);
-		//double dXg = F;
-		double dF = Xr * ddXr + dXr * dXr + Xi * ddXs + dXi * dXi;
-
-		//double dg = F / G;
-		//double ddXg = (dF * G - F * dg) / G;
-		//double dw = dXg / ddXg;
-		double dw = F / (dF - (F * F) / G2);
-		//fprintf(stderr, "dw: %f\n", dw);
+		double dF = Xr * ddXr + dXr * dXr + Xi * ddXi + dXi * dXi;
+		double dw = newton_step(F, dF, G2);
 
 		omega_rad -= dw;
 
-		if (omega_rad < 0)
-			omega_rad *= -1;
-
-		while (omega_rad > M_PI * 2.0)
+		while (omega_rad > M_PI)
 			omega_rad -= M_PI * 2.0;
 
-		if (omega_rad > M_PI)
-			omega_rad = M_PI * 2.0 - omega_rad;
+		while (omega_rad <= -M_PI)
+			omega_rad += M_PI * 2.0;
 
-		// Last iteration
-		if (loop == MAX_LOOPS) {
-		    result->frequency = omega_rad;
-		    //assume zero-phase sine
-		    result->phase = M_PI / 2 - atan(Xi / Xr);
-		    if (Xr < 0)
-			    result->phase += M_PI;
+		if (loop == NEWTON_MAX_LOOPS || fabs(dw) < NEWTON_TOLERANCE) {
+			result->frequency = omega_rad;
+			result->phase = atan2(Xi, Xr);
+			break;
 		}
 	}
 }
 
-static void gha_generate_sine(FLOAT* buf, size_t size, FLOAT omega, FLOAT phase)
-{
-	int i;
-	for (i = 0; i < size; i++) {
-		buf[i] = sin(omega * i + phase);
-	}
-}
-
-static void gha_estimate_magnitude(const FLOAT* pcm, const FLOAT* regen, size_t size, struct gha_info* result)
-{
-	int i;
-	double t1 = 0;
-	double t2 = 0;
-	for (i = 0; i < size; i++) {
-		t1 += pcm[i] * regen[i];
-		t2 += regen[i] * regen[i];
-	}
-
-	result->magnitude = t1 / t2;
-}
-
-int gha_adjust_info_newton_md(const FLOAT* pcm, struct gha_info* info, size_t dim, gha_ctx_t ctx)
+/*
+ * Newton optimization of all components, res (ctx->size samples) is the residual
+ * before the last step on return. Groups of local adjustment are adjusted many
+ * times, for them (local is not zero) the sines are produced by rotation and
+ * the loop stops once the step is negligible.
+ */
+static int gha_adjust_newton(const FLOAT* pcm, struct gha_info* info, size_t dim, FLOAT* res, int local, gha_ctx_t ctx)
 {
 	size_t loop;
 	size_t i, j, k, n;
+	int converged;
 
-	const size_t MAX_LOOPS = 7;
-
-	for (loop = 0; loop < MAX_LOOPS; loop++) {
-		memcpy(ctx->tmp_buf, pcm, ctx->size * sizeof(FLOAT));
+	for (loop = 0; loop < GHA_ADJUST_LOOPS; loop++) {
 
 		// Use VLA for a while
 		FLOAT BA[dim][ctx->size];
@@ -231,14 +650,34 @@ int gha_adjust_info_newton_md(const FLOAT* pcm, struct gha_info* info, size_t di
 		FLOAT Bwp[dim][ctx->size];
 		FLOAT Bpp[dim][ctx->size];
 
+		/* sin and cos of wk * n + pk by rotation */
+		double ra[dim], rb[dim], rc[dim], rs[dim];
+		for (k = 0; k < dim; k++) {
+			ra[k] = cos((info+k)->frequency);
+			rb[k] = sin((info+k)->frequency);
+			rc[k] = cos((info+k)->phase);
+			rs[k] = sin((info+k)->phase);
+		}
+
 		for (n = 0; n < ctx->size; n++) {
+			FLOAT r = pcm[n];
 			for (k = 0; k < dim; k++) {
 				FLOAT Ak = (info+k)->magnitude;
-				FLOAT wk = (info+k)->frequency;
-				FLOAT pk = (info+k)->phase;
-				FLOAT s = sin(wk * n + pk);
-				FLOAT c = cos(wk * n + pk);
-				ctx->tmp_buf[n] -= Ak * s;
+				FLOAT s, c;
+				if (local) {
+					const double new_c = ra[k] * rc[k] - rb[k] * rs[k];
+					const double new_s = rb[k] * rc[k] + ra[k] * rs[k];
+					s = rs[k];
+					c = rc[k];
+					rc[k] = new_c;
+					rs[k] = new_s;
+				} else {
+					FLOAT wk = (info+k)->frequency;
+					FLOAT pk = (info+k)->phase;
+					s = sin(wk * n + pk);
+					c = cos(wk * n + pk);
+				}
+				r -= Ak * s;
 
 				BA[k][n] = -s;
 				Bw[k][n] = -Ak * n * c;
@@ -251,6 +690,7 @@ int gha_adjust_info_newton_md(const FLOAT* pcm, struct gha_info* info, size_t di
 				Bpp[k][n] = Ak * s;
 
 			}
+			res[n] = r;
 		}
 
 		double M[dim * 3][dim * 3 + 1];
@@ -260,13 +700,13 @@ int gha_adjust_info_newton_md(const FLOAT* pcm, struct gha_info* info, size_t di
 				for (n = 0; n < ctx->size; n++) {
 					if (i == j) {
 						M[i + dim * 0][j + dim * 0] += BA[i][n] * BA[i][n];
-						M[i + dim * 0][j + dim * 1] += ctx->tmp_buf[n] * BAw[i][n] + BA[i][n] * Bw[i][n];
-						M[i + dim * 0][j + dim * 2] += ctx->tmp_buf[n] * BAp[i][n] + BA[i][n] * Bp[i][n];
+						M[i + dim * 0][j + dim * 1] += res[n] * BAw[i][n] + BA[i][n] * Bw[i][n];
+						M[i + dim * 0][j + dim * 2] += res[n] * BAp[i][n] + BA[i][n] * Bp[i][n];
 
-						M[i + dim * 1][j + dim * 1] += ctx->tmp_buf[n] * Bww[i][n] + Bw[i][n] * Bw[i][n];
-						M[i + dim * 1][j + dim * 2] += ctx->tmp_buf[n] * Bwp[i][n] + Bw[i][n] * Bp[i][n];
+						M[i + dim * 1][j + dim * 1] += res[n] * Bww[i][n] + Bw[i][n] * Bw[i][n];
+						M[i + dim * 1][j + dim * 2] += res[n] * Bwp[i][n] + Bw[i][n] * Bp[i][n];
 
-						M[i + dim * 2][j + dim * 2] += ctx->tmp_buf[n] * Bpp[i][n] + Bp[i][n] * Bp[i][n];
+						M[i + dim * 2][j + dim * 2] += res[n] * Bpp[i][n] + Bp[i][n] * Bp[i][n];
 					} else {
 						M[i + dim * 0][j + dim * 0] += BA[i][n] * BA[j][n];
 						M[i + dim * 0][j + dim * 1] += BA[i][n] * Bw[j][n];
@@ -296,9 +736,9 @@ int gha_adjust_info_newton_md(const FLOAT* pcm, struct gha_info* info, size_t di
 
 		for (k = 0; k < dim; k++) {
 			for (n = 0; n < ctx->size; n++) {
-				M[k + dim * 0][dim * 3] += ctx->tmp_buf[n] * BA[k][n];
-				M[k + dim * 1][dim * 3] += ctx->tmp_buf[n] * Bw[k][n];
-				M[k + dim * 2][dim * 3] += ctx->tmp_buf[n] * Bp[k][n];
+				M[k + dim * 0][dim * 3] += res[n] * BA[k][n];
+				M[k + dim * 1][dim * 3] += res[n] * Bw[k][n];
+				M[k + dim * 2][dim * 3] += res[n] * Bp[k][n];
 			}
 			M[k + dim * 0][dim * 3] *= 2;
 			M[k + dim * 1][dim * 3] *= 2;
@@ -311,6 +751,14 @@ int gha_adjust_info_newton_md(const FLOAT* pcm, struct gha_info* info, size_t di
 			return -1;
 		}
 
+		/* the step is negligible for all components */
+		converged = 1;
+		for (k = 0; k < dim; k++) {
+			if (fabs(fx0[k + dim * 0]) > GHA_ADJUST_TOLERANCE * (info+k)->magnitude ||
+				fabs(fx0[k + dim * 1]) * ctx->size > GHA_ADJUST_TOLERANCE || fabs(fx0[k + dim * 2]) > GHA_ADJUST_TOLERANCE)
+				converged = 0;
+		}
+
 		for (k = 0; k < dim; k++) {
 			//fprintf(stderr, "delta1: %f\n", fx0[k + dim * 0]);
 			//fprintf(stderr, "delta2: %f\n", fx0[k + dim * 1]);
@@ -356,54 +804,1555 @@ int gha_adjust_info_newton_md(const FLOAT* pcm, struct gha_info* info, size_t di
 				(info+k)->phase += M_PI * 2;
 			}
 		}
+
+		if (local && converged)
+			break;
 	}
 	return 0;
 }
 
-void gha_analyze_one(const FLOAT* pcm, struct gha_info* info, gha_ctx_t ctx)
+int gha_adjust_info_newton_md(const FLOAT* pcm, struct gha_info* info, size_t dim, gha_ctx_t ctx)
 {
-	int i = 0;
-	int bin = 0;
+	return gha_adjust_newton(pcm, info, dim, ctx->tmp_buf, 0, ctx);
+}
 
-	for (i = 0; i < ctx->size; i++)
-		ctx->tmp_buf[i] = pcm[i] * ctx->window[i];
+/*
+ * res = pcm + gain * sum of the components, the sines are produced by rotation,
+ * res may be pcm
+ */
+static void gha_add_info(const FLOAT* pcm, const struct gha_info* info, size_t k, double gain, FLOAT* res, size_t size)
+{
+	size_t n, j;
+
+	/* no zero length arrays */
+	if (k == 0) {
+		if (res != pcm)
+			memcpy(res, pcm, sizeof(FLOAT) * size);
+		return;
+	}
+
+	double a[k], b[k], c[k], s[k];
 
-	kiss_fftr(ctx->fftr, ctx->tmp_buf, ctx->fft_out);
+	for (j = 0; j < k; j++) {
+		a[j] = cos(info[j].frequency);
+		b[j] = sin(info[j].frequency);
+		c[j] = cos(info[j].phase);
+		s[j] = sin(info[j].phase);
+	}
 
-	bin = gha_estimate_bin(ctx);
+	for (n = 0; n < size; n++) {
+		double sum = 0;
+		for (j = 0; j < k; j++) {
+			const double new_c = a[j] * c[j] - b[j] * s[j];
+			const double new_s = b[j] * c[j] + a[j] * s[j];
+			sum += info[j].magnitude * s[j];
+			c[j] = new_c;
+			s[j] = new_s;
+		}
+		res[n] = pcm[n] + gain * sum;
+	}
+}
 
-	gha_search_omega_newton(ctx->tmp_buf, bin, ctx->size, info);
-	gha_generate_sine(ctx->tmp_buf, ctx->size, info->frequency, info->phase);
-	gha_estimate_magnitude(pcm, ctx->tmp_buf, ctx->size, info);
+/*
+ * Magnitude of the sine with found frequency and phase, tmp_buf is overwritten
+ */
+static void gha_fit_magnitude(const FLOAT* pcm, struct gha_info* info, gha_ctx_t ctx)
+{
+	ctx->kernels->frame.sine(ctx->tmp_buf, ctx->size, info->frequency, info->phase);
+	info->magnitude = ctx->kernels->frame.fit(pcm, ctx->tmp_buf, ctx->size);
 }
 
-void gha_extract_one(FLOAT* pcm, struct gha_info* info, gha_ctx_t ctx)
+/*
+ * Magnitude fit if it is wanted, unwanted fields are zeroed
+ */
+static void gha_fit_fields(const FLOAT* pcm, struct gha_info* info, unsigned fields, gha_ctx_t ctx)
 {
-	int i;
-	FLOAT magnitude;
-	gha_analyze_one(pcm, info, ctx);
-	magnitude = info->magnitude;
+	if (fields & GHA_FIELD_MAGNITUDE)
+		gha_fit_magnitude(pcm, info, ctx);
+	else
+		info->magnitude = 0;
 
-	for (i = 0; i < ctx->size; i++)
-		pcm[i] -= ctx->tmp_buf[i] * magnitude;
+	if (!(fields & GHA_FIELD_PHASE))
+		info->phase = 0;
+}
 
-	if (ctx->resuidal_cb)
-		ctx->resuidal_cb(pcm, ctx->size, ctx->user_ctx);
+/*
+ * Refine frequency starting from omega, windowed pcm is expected in tmp_buf
+ */
+static void gha_analyze_omega(const FLOAT* pcm, double omega, struct gha_info* info, unsigned fields, gha_ctx_t ctx)
+{
+	ctx->kernels->frame.newton(ctx->tmp_buf, omega, ctx->size, ctx->omega_min, ctx->omega_max, NEWTON_MAX_LOOPS, info);
+	gha_fit_fields(pcm, info, fields, ctx);
 }
 
-void gha_extract_many_simple(FLOAT* pcm, struct gha_info* info, size_t k, gha_ctx_t ctx)
+/*
+ * Spectrum of the windowed frame at omega interpolated from fft_out bins around it:
+ * X(omega) = sum X[k] * D(omega - 2 * pi * k / M) / M, D(x) = exp(-i * x * (M - 1) / 2) * sin(M * x / 2) / sin(x / 2)
+ * is the Dirichlet kernel of fft size M. The windowed spectrum falls off fast, so the sum is
+ * truncated to GHA_SPECTRAL_BINS bins on each side. Xr and Xi are the same as in
+ * frame_newton: sums of x * cos(omega * n) and x * sin(omega * n).
+ */
+static void gha_spectral_dtft(const kiss_fft_cpx* out, size_t fft_size, double omega, double* Xr, double* Xi)
 {
-	int i;
-	for (i = 0; i < k; i++) {
-		gha_extract_one(pcm, info + i, ctx);
+	const ptrdiff_t m = fft_size;
+	const ptrdiff_t bin = lround(omega * m / (2 * M_PI));
+	/* half bin rotation, sin((omega - 2 * pi * k / M) / 2) is computed from cos and sin of pi * k / M */
+	const double step = M_PI / m;
+	const double a = cos(step);
+	const double b = sin(step);
+	const double ca = cos(omega / 2);
+	const double sa = sin(omega / 2);
+	const double g = sin(m * omega / 2) / m;
+	const double cp = cos(omega * (m - 1) / 2);
+	const double sp = sin(omega * (m - 1) / 2);
+	ptrdiff_t k = bin - GHA_SPECTRAL_BINS;
+	double cb = cos(k * step);
+	double sb = sin(k * step);
+	double re = 0;
+	double im = 0;
+
+	for (; k <= bin + GHA_SPECTRAL_BINS; k++) {
+		/* the real fft keeps half of the spectrum, the rest is conjugate */
+		const ptrdiff_t j = (k % m + m) % m;
+		const kiss_fft_cpx y = j <= m / 2 ? out[j] : out[m - j];
+		const double yi = j <= m / 2 ? y.i : -y.i;
+		const double d = sa * cb - ca * sb;
+		double new_cb, new_sb;
+
+		if (fabs(d) < 1e-12) {
+			*Xr = y.r;
+			*Xi = -yi;
+			return;
+		}
+
+		/* y * exp(-i * pi * k / M) / d, (-1)^k of the kernel phase and of sin(M * x / 2) cancel */
+		re += (y.r * cb + yi * sb) / d;
+		im += (yi * cb - y.r * sb) / d;
+
+		new_cb = a * cb - b * sb;
+		new_sb = b * cb + a * sb;
+		cb = new_cb;
+		sb = new_sb;
 	}
+
+	/* common factor exp(-i * omega * (M - 1) / 2) * sin(M * omega / 2) / M */
+	*Xr = g * (re * cp + im * sp);
+	*Xi = -g * (im * cp - re * sp);
 }
 
-int gha_adjust_info(const FLOAT* pcm, struct gha_info* info, size_t k, gha_ctx_t ctx)
+/*
+ * Newton search of maximum of the interpolated spectrum, derivatives are estimated
+ * by finite differences, so each iteration is O(1) regardless of frame size.
+ */
+static void gha_search_omega_spectral(double omega_rad, struct gha_info* result, gha_ctx_t ctx)
 {
-	int rv = gha_adjust_info_newton_md(pcm, info, k, ctx);
-	if (ctx->resuidal_cb)
-		ctx->resuidal_cb(ctx->tmp_buf, ctx->size, ctx->user_ctx);
+	size_t loop;
+	int edge = 0;
+	const double h = GHA_SPECTRAL_STEP * 2 * M_PI / ctx->fft_size;
+	double Xr, Xi;
+
+	for (loop = 0; loop <= NEWTON_MAX_LOOPS; loop++) {
+		double p[3];
+		double dp, ddp, dw;
+		int i;
+
+		for (i = 0; i < 3; i++) {
+			gha_spectral_dtft(ctx->fft_out, ctx->fft_size, omega_rad + (i - 1) * h, &Xr, &Xi);
+			p[i] = Xr * Xr + Xi * Xi;
+		}
+
+		/* the same step as in frame_newton: Newton over magnitude */
+		dp = (p[2] - p[0]) / (2 * h);
+		ddp = (p[0] - 2 * p[1] + p[2]) / (h * h) - dp * dp / (2 * p[1]);
+
+		/* quarter of bin to the bigger side if the magnitude is not concave here */
+		if (ddp < 0)
+			dw = dp / ddp;
+		else
+			dw = dp > 0 ? -h * 25 : h * 25;
+
+		omega_rad -= dw;
+
+		const int was_edge = edge;
+		edge = newton_clamp(&omega_rad, ctx->omega_min, ctx->omega_max);
+
+		if (fabs(dw) < NEWTON_TOLERANCE || (edge && was_edge))
+			break;
+	}
+
+	gha_spectral_dtft(ctx->fft_out, ctx->fft_size, omega_rad, &Xr, &Xi);
+
+	result->frequency = omega_rad;
+	result->phase = newton_phase(Xr, Xi);
+}
+
+/*
+ * Initial frequency estimated on decimated frame: fft and Newton search over dec_size samples
+ */
+static double gha_decimated_omega(const FLOAT* pcm, gha_ctx_t ctx)
+{
+	size_t first, last, bin;
+	struct gha_info res;
+	const size_t factor = ctx->dec_factor;
+	FLOAT* frame = ctx->dec_buf + ctx->dec_half + 1;
+	const double omega_max = ctx->omega_max * factor;
+
+	decimate(pcm, ctx->dec_buf, ctx->dec_half, factor, ctx->dec_win->coef, frame, ctx->dec_size);
+	memset(frame + ctx->dec_size, 0, sizeof(FLOAT) * (ctx->dec_fft_size - ctx->dec_size));
+
+	ctx->kernels->fft.real(ctx->dec_fft, frame, ctx->dec_out);
+
+	gha_band_bins(ctx, ctx->dec_fft_size, factor, &first, &last);
+	bin = gha_estimate_bin(ctx->dec_out, first, last, ctx);
+
+	ctx->kernels->frame.newton(frame, bin * 2 * M_PI / ctx->dec_fft_size, ctx->dec_size,
+		ctx->omega_min * factor, omega_max < M_PI ? omega_max : M_PI, NEWTON_MAX_LOOPS, &res);
+
+	return res.frequency / factor;
+}
+
+/*
+ * Zoom in to the peak found at omega in windowed frame x: the frame is mixed down
+ * by omega and summed in to blocks, so the fft of the blocks evaluates the spectrum
+ * on the fine grid around omega. The block sum response is compensated and the
+ * maximum within one bin is interpolated by parabola over log power.
+ */
+static double gha_zoom_omega(const FLOAT* x, double omega, gha_ctx_t ctx)
+{
+	size_t j, m, k;
+	const size_t d = ctx->zoom_decimation;
+	const size_t p = ctx->zoom_size;
+	/* one fft bin in zoom points */
+	const size_t range = (double)p * d / ctx->fft_size + 1;
+	const double step = 2 * M_PI / ((double)p * d);
+	const double a = cos(omega * d);
+	const double b = sin(omega * d);
+	double* rc = ctx->zoom_rot;
+	double* rs = ctx->zoom_rot + d;
+	kiss_fft_cpx* in = ctx->zoom_buf;
+	kiss_fft_cpx* out = ctx->zoom_buf + p;
+	/* rotation of block start */
+	double c = 1.0;
+	double s = 0.0;
+	double power[3];
+	double max = 0;
+	ptrdiff_t i, best = 0;
+
+	/* rotation within a block is the same for all blocks, so no dependency chain over the frame */
+	gha_generate_rotation(rc, rs, d, omega);
+
+	for (m = 0; m < ctx->zoom_blocks; m++) {
+		const FLOAT* xb = x + m * d;
+		const size_t len = m * d + d < ctx->size ? d : ctx->size - m * d;
+		double re = 0;
+		double im = 0;
+		double new_c, new_s;
+		for (j = 0; j < len; j++) {
+			re += xb[j] * rc[j];
+			im += xb[j] * rs[j];
+		}
+		/* exp(-i * omega * n) = conj((c + i * s) * (rc + i * rs)) */
+		in[m].r = c * re - s * im;
+		in[m].i = -(s * re + c * im);
+		new_c = a * c - b * s;
+		new_s = b * c + a * s;
+		c = new_c;
+		s = new_s;
+	}
+	memset(in + ctx->zoom_blocks, 0, sizeof(kiss_fft_cpx) * (p - ctx->zoom_blocks));
+
+	ctx->kernels->fft.cpx(ctx->zoom_fft, in, out);
+
+	for (i = -(ptrdiff_t)range; i <= (ptrdiff_t)range; i++) {
+		double pw;
+		k = i < 0 ? p + i : i;
+		pw = out[k].r * out[k].r + out[k].i * out[k].i;
+		if (i) {
+			/* block sum response */
+			const double h = sin(i * step * d / 2) / (d * sin(i * step / 2));
+			pw /= h * h;
+		}
+		if (pw > max) {
+			max = pw;
+			best = i;
+		}
+	}
+
+	if (best == -(ptrdiff_t)range || best == (ptrdiff_t)range || max == 0)
+		return omega + best * step;
+
+	for (i = -1; i <= 1; i++) {
+		const ptrdiff_t j = best + i;
+		double h = 1.0;
+		k = j < 0 ? p + j : j;
+		if (j)
+			h = sin(j * step * d / 2) / (d * sin(j * step / 2));
+		power[i + 1] = log((out[k].r * out[k].r + out[k].i * out[k].i) / (h * h) + 1e-300);
+	}
+
+	omega += step * (best + 0.5 * (power[0] - power[2]) / (power[0] - 2 * power[1] + power[2]));
+
+	return omega;
+}
+
+/*
+ * Estimate the component at the peak bin from the bin and its neighbours,
+ * bin j is re[j * stride] + i * im[j * stride]. The peak offset and the window
+ * response at it are exact for sine and Hann windows without padding (main lobe
+ * shapes cos(pi * d) / (1 - 4 * d^2) and sinc(d) / (1 - d^2)), parabola over
+ * log magnitude is used otherwise.
+ */
+static void gha_interpolate_bin(size_t bin, const FLOAT* re, const FLOAT* im, size_t stride, struct gha_info* info, gha_ctx_t ctx)
+{
+	const size_t m = ctx->fft_size;
+	/* neighbours of the first and the last bins are their mirrors */
+	const size_t prev = bin ? bin - 1 : 1;
+	const size_t next = bin < m / 2 ? bin + 1 : m - bin - 1;
+	const double a = hypot(re[prev * stride], im[prev * stride]);
+	const double b = hypot(re[bin * stride], im[bin * stride]);
+	const double c = hypot(re[next * stride], im[next * stride]);
+	const double xr = re[bin * stride];
+	const double xi = -im[bin * stride];
+	const int exact = m == ctx->size && (ctx->win->type == GHA_WINDOW_SINE || ctx->win->type == GHA_WINDOW_HANN);
+	/* window response at the bin relative to the peak */
+	double d, gain = 1.0;
+	double omega, phase;
+
+	if (b == 0) {
+		info->frequency = bin * 2 * M_PI / m;
+		info->phase = 0;
+		info->magnitude = 0;
+		return;
+	}
+
+	if (exact && ctx->win->type == GHA_WINDOW_SINE) {
+		d = c > a ? (3 * c - b) / (2 * (b + c)) : -(3 * a - b) / (2 * (b + a));
+		gain = cos(M_PI * d) / (1 - 4 * d * d);
+	} else if (exact) {
+		d = c > a ? (2 * c - b) / (b + c) : -(2 * a - b) / (b + a);
+		gain = d == 0 ? 1.0 : sin(M_PI * d) / (M_PI * d * (1 - d * d));
+	} else if (a > 0 && c > 0) {
+		const double la = log(a), lb = log(b), lc = log(c);
+		const double den = la - 2 * lb + lc;
+		d = den < 0 ? 0.5 * (la - lc) / den : 0.0;
+		gain = exp(0.25 * (la - lc) * d);
+	} else {
+		d = 0.0;
+	}
+
+	if (d > 0.5)
+		d = 0.5;
+	if (d < -0.5)
+		d = -0.5;
+
+	omega = (bin + d) * 2 * M_PI / m;
+	newton_clamp(&omega, ctx->omega_min, ctx->omega_max);
+
+	/* phase at the bin moves by the bin offset times the window center */
+	phase = fmod(newton_phase(xr, xi) - d * M_PI * (ctx->size - 1) / m, 2 * M_PI);
+	if (phase < 0)
+		phase += 2 * M_PI;
+
+	info->frequency = omega;
+	info->phase = phase;
+	info->magnitude = 2 * b / (gain * ctx->win->sum);
+}
+
+/*
+ * Fast estimation: window, fft and peak interpolation only, windowed pcm is expected in tmp_buf
+ */
+static void gha_analyze_fast(struct gha_info* info, gha_ctx_t ctx)
+{
+	size_t first, last, bin;
+
+	memset(ctx->tmp_buf + ctx->size, 0, sizeof(FLOAT) * (ctx->fft_size - ctx->size));
+
+	ctx->kernels->fft.real(ctx->fft, ctx->tmp_buf, ctx->fft_out);
+
+	gha_band_bins(ctx, ctx->fft_size, 1, &first, &last);
+	bin = gha_estimate_bin(ctx->fft_out, first, last, ctx);
+
+	gha_interpolate_bin(bin, &ctx->fft_out[0].r, &ctx->fft_out[0].i, 2, info, ctx);
+}
+
+/*
+ * Windowed pcm is expected in tmp_buf, fields is a mask of GHA_FIELD_*
+ */
+static void gha_analyze_windowed(const FLOAT* pcm, struct gha_info* info, unsigned fields, gha_ctx_t ctx)
+{
+	size_t first, last, bin;
+	double omega;
+
+	if (ctx->quality == GHA_QUALITY_FAST) {
+		gha_analyze_fast(info, ctx);
+		if (!(fields & GHA_FIELD_MAGNITUDE))
+			info->magnitude = 0;
+		if (!(fields & GHA_FIELD_PHASE))
+			info->phase = 0;
+		return;
+	}
+
+	if (ctx->dec_factor) {
+		gha_analyze_omega(pcm, gha_decimated_omega(pcm, ctx), info, fields, ctx);
+		return;
+	}
+
+	memset(ctx->tmp_buf + ctx->size, 0, sizeof(FLOAT) * (ctx->fft_size - ctx->size));
+
+	ctx->kernels->fft.real(ctx->fft, ctx->tmp_buf, ctx->fft_out);
+
+	gha_band_bins(ctx, ctx->fft_size, 1, &first, &last);
+	bin = gha_estimate_bin(ctx->fft_out, first, last, ctx);
+
+	omega = bin * 2 * M_PI / ctx->fft_size;
+	if (ctx->zoom) {
+		omega = gha_zoom_omega(ctx->tmp_buf, omega, ctx);
+		newton_clamp(&omega, ctx->omega_min, ctx->omega_max);
+	}
+
+	if (ctx->refine == GHA_REFINE_TIME) {
+		gha_analyze_omega(pcm, omega, info, fields, ctx);
+		return;
+	}
+
+	gha_search_omega_spectral(omega, info, ctx);
+	if (ctx->refine == GHA_REFINE_SPECTRAL_POLISH)
+		ctx->kernels->frame.newton(ctx->tmp_buf, info->frequency, ctx->size, ctx->omega_min, ctx->omega_max, 0, info);
+	gha_fit_fields(pcm, info, fields, ctx);
+}
+
+FLOAT gha_estimate_peak(const FLOAT* pcm, double* omega, gha_ctx_t ctx)
+{
+	size_t first, last, bin;
+	const double sum = ctx->win->sum;
+
+	ctx->kernels->frame.window(pcm, ctx->window, ctx->size, ctx->tmp_buf);
+	memset(ctx->tmp_buf + ctx->size, 0, sizeof(FLOAT) * (ctx->fft_size - ctx->size));
+
+	ctx->kernels->fft.real(ctx->fft, ctx->tmp_buf, ctx->fft_out);
+
+	gha_band_bins(ctx, ctx->fft_size, 1, &first, &last);
+	bin = gha_estimate_bin(ctx->fft_out, first, last, ctx);
+
+	*omega = bin * 2 * M_PI / ctx->fft_size;
+
+	return 2 * sqrt(ctx->fft_out[bin].r * ctx->fft_out[bin].r + ctx->fft_out[bin].i * ctx->fft_out[bin].i) / sum;
+}
+
+size_t gha_find_peaks(const FLOAT* pcm, size_t k, FLOAT threshold, const unsigned char* mask,
+	size_t* bins, FLOAT* magnitude, gha_ctx_t ctx)
+{
+	size_t i, n, first, last;
+	/* magnitude of sine is 2 * |X| / sum of window */
+	const double scale = 2 / ctx->win->sum;
+	const double limit = threshold > 0 ? threshold / scale : 0;
+
+	ctx->kernels->frame.window(pcm, ctx->window, ctx->size, ctx->tmp_buf);
+	memset(ctx->tmp_buf + ctx->size, 0, sizeof(FLOAT) * (ctx->fft_size - ctx->size));
+
+	ctx->kernels->fft.real(ctx->fft, ctx->tmp_buf, ctx->fft_out);
+
+	gha_band_bins(ctx, ctx->fft_size, 1, &first, &last);
+	n = ctx->kernels->peaks.find(ctx->fft_out, first, last, limit * limit, mask, k, ctx->fft_power, bins, magnitude);
+
+	for (i = 0; i < n; i++)
+		magnitude[i] = scale * sqrt(magnitude[i]);
+
+	return n;
+}
+
+size_t gha_get_fft_size(gha_ctx_t ctx)
+{
+	return ctx->fft_size;
+}
+
+void gha_analyze_from(const FLOAT* pcm, double omega, struct gha_info* info, gha_ctx_t ctx)
+{
+	ctx->kernels->frame.window(pcm, ctx->window, ctx->size, ctx->tmp_buf);
+
+	gha_analyze_omega(pcm, omega, info, ctx->fields, ctx);
+}
+
+static void gha_no_component(struct gha_info* info, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		info[i].frequency = 0;
+		info[i].phase = 0;
+		info[i].magnitude = 0;
+	}
+}
+
+/*
+ * Frame (sample n is pcm[n * stride]) is below the energy gate,
+ * info is zeroed then
+ */
+static int gha_gated(const FLOAT* pcm, size_t stride, struct gha_info* info, gha_ctx_t ctx)
+{
+	size_t n;
+	double energy = 0;
+
+	if (ctx->gate == 0)
+		return 0;
+
+	if (stride == 1) {
+		energy = ctx->kernels->pcm.energy(pcm, ctx->size);
+	} else {
+		for (n = 0; n < ctx->size; n++)
+			energy += pcm[n * stride] * pcm[n * stride];
+	}
+
+	if (energy >= ctx->gate)
+		return 0;
+
+	gha_no_component(info, 1);
+	return 1;
+}
+
+int gha_analyze_one(const FLOAT* pcm, struct gha_info* info, gha_ctx_t ctx)
+{
+	if (gha_gated(pcm, 1, info, ctx))
+		return GHA_NO_COMPONENT;
+
+	ctx->kernels->frame.window(pcm, ctx->window, ctx->size, ctx->tmp_buf);
+
+	gha_analyze_windowed(pcm, info, ctx->fields, ctx);
+	return 0;
+}
+
+static int gha_analyze_pcm(const void* pcm, enum pcm_format format, struct gha_info* info, gha_ctx_t ctx)
+{
+	ctx->kernels->pcm.window(pcm, format, ctx->window, ctx->size, ctx->raw_buf, ctx->tmp_buf);
+	if (gha_gated(ctx->raw_buf, 1, info, ctx))
+		return GHA_NO_COMPONENT;
+
+	gha_analyze_windowed(ctx->raw_buf, info, ctx->fields, ctx);
+	return 0;
+}
+
+int gha_analyze_one_s16(const int16_t* pcm, struct gha_info* info, gha_ctx_t ctx)
+{
+	return gha_analyze_pcm(pcm, PCM_S16, info, ctx);
+}
+
+int gha_analyze_one_s24(const uint8_t* pcm, struct gha_info* info, gha_ctx_t ctx)
+{
+	return gha_analyze_pcm(pcm, PCM_S24, info, ctx);
+}
+
+int gha_analyze_one_s32(const int32_t* pcm, struct gha_info* info, gha_ctx_t ctx)
+{
+	return gha_analyze_pcm(pcm, PCM_S32, info, ctx);
+}
+
+int gha_analyze_one_u8(const uint8_t* pcm, struct gha_info* info, gha_ctx_t ctx)
+{
+	return gha_analyze_pcm(pcm, PCM_U8, info, ctx);
+}
+
+int gha_analyze_one_ulaw(const uint8_t* pcm, struct gha_info* info, gha_ctx_t ctx)
+{
+	return gha_analyze_pcm(pcm, PCM_ULAW, info, ctx);
+}
+
+int gha_analyze_one_alaw(const uint8_t* pcm, struct gha_info* info, gha_ctx_t ctx)
+{
+	return gha_analyze_pcm(pcm, PCM_ALAW, info, ctx);
+}
+
+static int gha_init_batch(gha_ctx_t ctx, size_t lanes)
+{
+	/* windowed and raw frames + spectrum re/im + fft work */
+	const size_t len = ctx->fft_size + ctx->size + (ctx->fft_size/2 + 1) * 2 + ctx->fft_size * 2;
+
+	if (ctx->batch_buf)
+		return 0;
+
+	ctx->batch_buf = malloc(sizeof(FLOAT) * len * lanes);
+	if (!ctx->batch_buf)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Analyze count frames, sample n of frame i is pcm[i][n * stride]
+ */
+static void gha_analyze_frames(const FLOAT* const* pcm, size_t stride, struct gha_info* info, size_t count, gha_ctx_t ctx)
+{
+	size_t i, l, cnt;
+	const size_t lanes = ctx->kernels->batch.lanes();
+	const size_t fft_lanes = ctx->kernels->fft.batch_lanes(ctx->fft);
+	const size_t bins = ctx->fft_size/2 + 1;
+	size_t first, last;
+	size_t bin[lanes];
+	double omega[lanes];
+	double phase[lanes];
+	double magnitude[lanes];
+	/* frames above the energy gate processed in the group and their results */
+	const FLOAT* live[lanes];
+	struct gha_info* out[lanes];
+	FLOAT *frames, *raw, *re, *im, *work;
+
+	/* decimated band estimation, zoom and spectral refinement are per frame */
+	if (lanes < 2 || ctx->dec_factor || ctx->zoom || ctx->refine != GHA_REFINE_TIME || gha_init_batch(ctx, lanes)) {
+		for (i = 0; i < count; i++) {
+			size_t n;
+			if (gha_gated(pcm[i], stride, info + i, ctx))
+				continue;
+			for (n = 0; n < ctx->size; n++) {
+				ctx->raw_buf[n] = pcm[i][n * stride];
+				ctx->tmp_buf[n] = ctx->raw_buf[n] * ctx->window[n];
+			}
+			gha_analyze_windowed(ctx->raw_buf, info + i, ctx->fields, ctx);
+		}
+		return;
+	}
+
+	gha_band_bins(ctx, ctx->fft_size, 1, &first, &last);
+
+	frames = ctx->batch_buf;
+	raw = frames + ctx->fft_size * lanes;
+	re = raw + ctx->size * lanes;
+	im = re + bins * lanes;
+	work = im + bins * lanes;
+
+	for (i = 0; i < count;) {
+		for (cnt = 0; cnt < lanes && i < count; i++) {
+			if (gha_gated(pcm[i], stride, info + i, ctx))
+				continue;
+			live[cnt] = pcm[i];
+			out[cnt] = info + i;
+			cnt++;
+		}
+
+		if (cnt == 0)
+			break;
+
+		ctx->kernels->batch.window(live, stride, cnt, ctx->window, ctx->size, ctx->fft_size, frames, raw);
+
+		if (fft_lanes == lanes) {
+			ctx->kernels->fft.real_batch(ctx->fft, frames, re, im, work);
+			ctx->kernels->batch.argmax(re + first * lanes, im + first * lanes, last - first + 1, bin);
+			for (l = 0; l < cnt; l++)
+				bin[l] += first;
+		} else {
+			for (l = 0; l < cnt; l++) {
+				size_t n;
+				for (n = 0; n < ctx->fft_size; n++)
+					ctx->tmp_buf[n] = frames[n * lanes + l];
+				ctx->kernels->fft.real(ctx->fft, ctx->tmp_buf, ctx->fft_out);
+				bin[l] = gha_estimate_bin(ctx->fft_out, first, last, ctx);
+				if (ctx->quality == GHA_QUALITY_FAST)
+					gha_interpolate_bin(bin[l], &ctx->fft_out[0].r, &ctx->fft_out[0].i, 2, out[l], ctx);
+			}
+		}
+
+		if (ctx->quality == GHA_QUALITY_FAST) {
+			for (l = 0; l < cnt; l++) {
+				if (fft_lanes == lanes)
+					gha_interpolate_bin(bin[l], re + l, im + l, lanes, out[l], ctx);
+				if (!(ctx->fields & GHA_FIELD_MAGNITUDE))
+					out[l]->magnitude = 0;
+				if (!(ctx->fields & GHA_FIELD_PHASE))
+					out[l]->phase = 0;
+			}
+			continue;
+		}
+
+		for (l = 0; l < lanes; l++) {
+			omega[l] = l < cnt ? bin[l] * 2 * M_PI / ctx->fft_size : 0.0;
+			phase[l] = 0.0;
+		}
+
+		ctx->kernels->batch.newton(frames, ctx->size, cnt, ctx->omega_min, ctx->omega_max, omega, phase);
+
+		for (l = 0; l < lanes; l++) {
+			/* use the same precision as gha_info for synthesis */
+			omega[l] = (FLOAT)omega[l];
+			phase[l] = (FLOAT)phase[l];
+		}
+
+		if (ctx->fields & GHA_FIELD_MAGNITUDE)
+			ctx->kernels->batch.magnitude(raw, ctx->size, cnt, omega, phase, magnitude);
+		else
+			memset(magnitude, 0, sizeof(magnitude));
+
+		for (l = 0; l < cnt; l++) {
+			out[l]->frequency = omega[l];
+			out[l]->phase = ctx->fields & GHA_FIELD_PHASE ? phase[l] : 0;
+			out[l]->magnitude = magnitude[l];
+		}
+	}
+}
+
+void gha_analyze_batch(const FLOAT* const* pcm, struct gha_info* info, size_t count, gha_ctx_t ctx)
+{
+	gha_analyze_frames(pcm, 1, info, count, ctx);
+}
+
+void gha_analyze_interleaved(const FLOAT* pcm, size_t channels, struct gha_info* info, gha_ctx_t ctx)
+{
+	size_t c;
+
+	/* frames below must not be a zero length array */
+	if (!channels)
+		return;
+
+	const FLOAT* frames[channels];
+
+	for (c = 0; c < channels; c++)
+		frames[c] = pcm + c;
+
+	gha_analyze_frames(frames, channels, info, channels, ctx);
+}
+
+static int gha_init_joint(gha_ctx_t ctx, size_t channels)
+{
+	/* windowed frames + summed power */
+	const size_t len = ctx->fft_size * channels + ctx->fft_size/2 + 1;
+	FLOAT* joint_buf;
+
+	if (!ctx->rot_buf) {
+		ctx->rot_buf = malloc(sizeof(double) * 2 * ctx->size);
+		if (!ctx->rot_buf)
+			return -1;
+	}
+
+	if (ctx->joint_buf && ctx->joint_channels >= channels)
+		return 0;
+
+	joint_buf = malloc(sizeof(FLOAT) * len);
+	if (!joint_buf)
+		return -1;
+
+	free(ctx->joint_buf);
+	ctx->joint_buf = joint_buf;
+	ctx->joint_channels = channels;
+
+	return 0;
+}
+
+/*
+ * Joint analysis, the regenerated unit sine of channel ch is
+ * sin * cos(phase) + cos * sin(phase) where cos and sin are left in rot_buf
+ */
+static int gha_analyze_joint_frames(const FLOAT* const* pcm, size_t channels, struct gha_info* info, gha_ctx_t ctx)
+{
+	size_t ch, i;
+	const size_t bins = ctx->fft_size/2 + 1;
+	FLOAT* power;
+	FLOAT max = 0.0;
+	size_t first, last, bin;
+	double* c;
+	double* s;
+
+	if (gha_init_joint(ctx, channels))
+		return -1;
+
+	power = ctx->joint_buf + ctx->fft_size * channels;
+	memset(power, 0, sizeof(FLOAT) * bins);
+
+	for (ch = 0; ch < channels; ch++) {
+		FLOAT* frame = ctx->joint_buf + ctx->fft_size * ch;
+		ctx->kernels->frame.window(pcm[ch], ctx->window, ctx->size, frame);
+		memset(frame + ctx->size, 0, sizeof(FLOAT) * (ctx->fft_size - ctx->size));
+
+		ctx->kernels->fft.real(ctx->fft, frame, ctx->fft_out);
+		for (i = 0; i < bins; i++)
+			power[i] += ctx->fft_out[i].r * ctx->fft_out[i].r + ctx->fft_out[i].i * ctx->fft_out[i].i;
+	}
+
+	gha_band_bins(ctx, ctx->fft_size, 1, &first, &last);
+	bin = first;
+	for (i = first; i <= last; i++) {
+		if (power[i] > max) {
+			max = power[i];
+			bin = i;
+		}
+	}
+
+	gha_search_omega_newton_joint(ctx->joint_buf, ctx->fft_size, channels, bin * 2 * M_PI / ctx->fft_size,
+		ctx->size, ctx->omega_min, ctx->omega_max, ctx->rot_buf, info);
+
+	c = ctx->rot_buf;
+	s = ctx->rot_buf + ctx->size;
+	gha_generate_rotation(c, s, ctx->size, info[0].frequency);
+
+	for (ch = 0; ch < channels; ch++) {
+		const double cp = cos(info[ch].phase);
+		const double sp = sin(info[ch].phase);
+		double t1 = 0;
+		double t2 = 0;
+		for (i = 0; i < ctx->size; i++) {
+			const double r = s[i] * cp + c[i] * sp;
+			t1 += pcm[ch][i] * r;
+			t2 += r * r;
+		}
+		info[ch].magnitude = t2 > 0 ? t1 / t2 : 0;
+	}
+
+	return 0;
+}
+
+void gha_analyze_joint(const FLOAT* const* pcm, size_t channels, struct gha_info* info, gha_ctx_t ctx)
+{
+	size_t ch;
+
+	if (!channels)
+		return;
+
+	if (gha_analyze_joint_frames(pcm, channels, info, ctx) == 0)
+		return;
+
+	for (ch = 0; ch < channels; ch++)
+		gha_analyze_one(pcm[ch], info + ch, ctx);
+}
+
+void gha_extract_one_joint(FLOAT* const* pcm, size_t channels, struct gha_info* info, gha_ctx_t ctx)
+{
+	size_t ch, i;
+	const double* c;
+	const double* s;
+
+	if (!channels)
+		return;
+
+	if (gha_analyze_joint_frames((const FLOAT* const*)pcm, channels, info, ctx)) {
+		for (ch = 0; ch < channels; ch++)
+			gha_extract_one(pcm[ch], info + ch, ctx);
+		return;
+	}
+
+	c = ctx->rot_buf;
+	s = ctx->rot_buf + ctx->size;
+
+	for (ch = 0; ch < channels; ch++) {
+		const double cp = cos(info[ch].phase) * info[ch].magnitude;
+		const double sp = sin(info[ch].phase) * info[ch].magnitude;
+		for (i = 0; i < ctx->size; i++)
+			pcm[ch][i] -= s[i] * cp + c[i] * sp;
+
+		if (ctx->resuidal_cb)
+			ctx->resuidal_cb(pcm[ch], ctx->size, ctx->user_ctx);
+	}
+}
+
+void gha_extract_many_joint(FLOAT* const* pcm, size_t channels, struct gha_info* info, size_t k, gha_ctx_t ctx)
+{
+	size_t i;
+
+	if (!channels)
+		return;
+
+	for (i = 0; i < k; i++) {
+		gha_extract_one_joint(pcm, channels, info + i * channels, ctx);
+	}
+}
+
+/*
+ * Sum of sin(omega * n + phase)^2 for n in [0, size)
+ */
+static double gha_sine_energy(size_t size, double omega, double phase)
+{
+	const double s = sin(omega);
+	double sum;
+
+	if (fabs(s) < 1e-9)
+		sum = size * cos(2 * phase);
+	else
+		sum = sin(size * omega) / s * cos((size - 1) * omega + 2 * phase);
+
+	return (size - sum) / 2;
+}
+
+/*
+ * Candidate may be off by up to this number of bins
+ */
+#define GHA_CANDIDATE_BINS 2
+#define GHA_CANDIDATE_POINTS (GHA_CANDIDATE_BINS * 2 + 1)
+
+/*
+ * Magnitude of x spectrum at omega + j * d for j in [-GHA_CANDIDATE_BINS, GHA_CANDIDATE_BINS]
+ * using Goertzel algorithm, all points are computed in one pass
+ */
+static void gha_goertzel(const FLOAT* x, size_t size, double omega, double d, double* m)
+{
+	size_t n;
+	int j;
+	double k[GHA_CANDIDATE_POINTS];
+	double s1[GHA_CANDIDATE_POINTS];
+	double s2[GHA_CANDIDATE_POINTS];
+
+	for (j = 0; j < GHA_CANDIDATE_POINTS; j++) {
+		k[j] = 2 * cos(omega + (j - GHA_CANDIDATE_BINS) * d);
+		s1[j] = 0;
+		s2[j] = 0;
+	}
+
+	for (n = 0; n < size; n++) {
+		for (j = 0; j < GHA_CANDIDATE_POINTS; j++) {
+			const double s0 = x[n] + k[j] * s1[j] - s2[j];
+			s2[j] = s1[j];
+			s1[j] = s0;
+		}
+	}
+
+	for (j = 0; j < GHA_CANDIDATE_POINTS; j++)
+		m[j] = sqrt(s1[j] * s1[j] + s2[j] * s2[j] - k[j] * s1[j] * s2[j]);
+}
+
+/*
+ * Start point of Newton search for approximate candidate frequency:
+ * the max of windowed spectrum magnitude on one bin grid around omega refined
+ * by parabolic interpolation, so the search starts inside the main lobe of
+ * the component, clamped to the band
+ */
+static double gha_candidate_start(const FLOAT* x, size_t size, double omega, gha_ctx_t ctx)
+{
+	int j, k = 0;
+	const double d = 2 * M_PI / size;
+	double m[GHA_CANDIDATE_POINTS];
+	double p = 0;
+
+	gha_goertzel(x, size, omega, d, m);
+
+	for (j = -GHA_CANDIDATE_BINS; j <= GHA_CANDIDATE_BINS; j++)
+		if (m[j + GHA_CANDIDATE_BINS] > m[k + GHA_CANDIDATE_BINS])
+			k = j;
+
+	if (k > -GHA_CANDIDATE_BINS && k < GHA_CANDIDATE_BINS) {
+		const double a = m[k + GHA_CANDIDATE_BINS - 1];
+		const double b = m[k + GHA_CANDIDATE_BINS];
+		const double c = m[k + GHA_CANDIDATE_BINS + 1];
+		/* b is the max, so den <= 0 */
+		const double den = a - 2 * b + c;
+		if (den < 0)
+			p = 0.5 * (a - c) / den;
+	}
+
+	omega += (k + p) * d;
+	if (omega < 0)
+		omega = -omega;
+	if (omega > M_PI)
+		omega = 2 * M_PI - omega;
+	if (omega < ctx->omega_min)
+		omega = ctx->omega_min;
+	if (omega > ctx->omega_max)
+		omega = ctx->omega_max;
+
+	return omega;
+}
+
+void gha_analyze_candidates(const FLOAT* pcm, const FLOAT* omega, size_t count, struct gha_info* info, FLOAT* fit, gha_ctx_t ctx)
+{
+	size_t i, l, cnt;
+	const size_t lanes = ctx->kernels->batch.lanes();
+	/* goodness of fit needs magnitude and phase */
+	const int magnitude_wanted = (ctx->fields & GHA_FIELD_MAGNITUDE) || fit;
+	double energy = 0;
+	double om[lanes];
+	double ph[lanes];
+	double magnitude[lanes];
+	const FLOAT* frames[lanes];
+	FLOAT *windowed, *raw;
+
+	for (i = 0; i < ctx->size; i++) {
+		energy += pcm[i] * pcm[i];
+		ctx->tmp_buf[i] = pcm[i] * ctx->window[i];
+	}
+
+	if (ctx->gate && energy < ctx->gate) {
+		gha_no_component(info, count);
+		if (fit)
+			memset(fit, 0, sizeof(FLOAT) * count);
+		return;
+	}
+
+	if (lanes < 2 || gha_init_batch(ctx, lanes)) {
+		for (i = 0; i < count; i++) {
+			const double start = gha_candidate_start(ctx->tmp_buf, ctx->size, omega[i], ctx);
+			ctx->kernels->frame.newton(ctx->tmp_buf, start, ctx->size, ctx->omega_min, ctx->omega_max,
+				NEWTON_MAX_LOOPS, info + i);
+			if (magnitude_wanted) {
+				ctx->kernels->frame.sine(ctx->raw_buf, ctx->size, info[i].frequency, info[i].phase);
+				info[i].magnitude = ctx->kernels->frame.fit(pcm, ctx->raw_buf, ctx->size);
+			} else {
+				info[i].magnitude = 0;
+			}
+		}
+	} else {
+		/* the same frame in each lane, candidates are refined in parallel */
+		windowed = ctx->batch_buf;
+		raw = windowed + ctx->size * lanes;
+		for (l = 0; l < lanes; l++)
+			frames[l] = pcm;
+		ctx->kernels->batch.window(frames, 1, lanes, ctx->window, ctx->size, ctx->size, windowed, raw);
+
+		for (i = 0; i < count; i += lanes) {
+			cnt = count - i < lanes ? count - i : lanes;
+
+			for (l = 0; l < lanes; l++) {
+				om[l] = l < cnt ? gha_candidate_start(ctx->tmp_buf, ctx->size, omega[i + l], ctx) : 0.0;
+				ph[l] = 0.0;
+			}
+
+			ctx->kernels->batch.newton(windowed, ctx->size, cnt, ctx->omega_min, ctx->omega_max, om, ph);
+
+			for (l = 0; l < lanes; l++) {
+				om[l] = (FLOAT)om[l];
+				ph[l] = (FLOAT)ph[l];
+			}
+
+			if (magnitude_wanted)
+				ctx->kernels->batch.magnitude(raw, ctx->size, cnt, om, ph, magnitude);
+			else
+				memset(magnitude, 0, sizeof(magnitude));
+
+			for (l = 0; l < cnt; l++) {
+				info[i + l].frequency = om[l];
+				info[i + l].phase = ph[l];
+				info[i + l].magnitude = magnitude[l];
+			}
+		}
+	}
+
+	/* energy of least squares sine fit relative to the frame energy */
+	for (i = 0; fit && i < count; i++) {
+		const double m = info[i].magnitude;
+		fit[i] = energy > 0 ? m * m * gha_sine_energy(ctx->size, info[i].frequency, info[i].phase) / energy : 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!(ctx->fields & GHA_FIELD_MAGNITUDE))
+			info[i].magnitude = 0;
+		if (!(ctx->fields & GHA_FIELD_PHASE))
+			info[i].phase = 0;
+	}
+}
+
+static int gha_init_complex(gha_ctx_t ctx)
+{
+	if (ctx->cpx_fft)
+		return 0;
+
+	ctx->cpx_buf = malloc(sizeof(kiss_fft_cpx) * ctx->fft_size * 2);
+	if (!ctx->cpx_buf)
+		return -1;
+
+	ctx->cpx_fft = ctx->kernels->fft.alloc_cpx(ctx->fft_size);
+	if (!ctx->cpx_fft) {
+		free(ctx->cpx_buf);
+		ctx->cpx_buf = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Magnitude of A * exp(i * (omega * n + phase)) in complex signal x
+ */
+static FLOAT gha_estimate_magnitude_complex(const kiss_fft_cpx* x, size_t size, double omega, double phase)
+{
+	size_t n;
+	const double a = cos(omega);
+	const double b = sin(omega);
+	double c = cos(phase);
+	double s = sin(phase);
+	double t = 0;
+
+	for (n = 0; n < size; n++) {
+		const double new_c = a * c - b * s;
+		const double new_s = b * c + a * s;
+		t += x[n].r * c + x[n].i * s;
+		c = new_c;
+		s = new_s;
+	}
+
+	return t / size;
+}
+
+int gha_analyze_one_complex(const FLOAT* iq, struct gha_info* info, gha_ctx_t ctx)
+{
+	size_t i, bin = 0;
+	FLOAT max = 0.0;
+	const kiss_fft_cpx* x = (const kiss_fft_cpx*)iq;
+	kiss_fft_cpx* in;
+	kiss_fft_cpx* out;
+	double omega;
+
+	if (gha_init_complex(ctx))
+		return -1;
+
+	in = ctx->cpx_buf;
+	out = ctx->cpx_buf + ctx->fft_size;
+
+	for (i = 0; i < ctx->size; i++) {
+		in[i].r = x[i].r * ctx->window[i];
+		in[i].i = x[i].i * ctx->window[i];
+	}
+	memset(in + ctx->size, 0, sizeof(kiss_fft_cpx) * (ctx->fft_size - ctx->size));
+
+	ctx->kernels->fft.cpx(ctx->cpx_fft, in, out);
+
+	for (i = 0; i < ctx->fft_size; i++) {
+		const FLOAT p = out[i].r * out[i].r + out[i].i * out[i].i;
+		if (p > max) {
+			max = p;
+			bin = i;
+		}
+	}
+
+	omega = bin * 2 * M_PI / ctx->fft_size;
+	if (omega > M_PI)
+		omega -= 2 * M_PI;
+
+	gha_search_omega_newton_complex(in, omega, ctx->size, info);
+	info->magnitude = gha_estimate_magnitude_complex(x, ctx->size, info->frequency, info->phase);
+
+	return 0;
+}
+
+int gha_extract_one_complex(FLOAT* iq, struct gha_info* info, gha_ctx_t ctx)
+{
+	size_t n;
+	double a, b, c, s;
+
+	if (gha_analyze_one_complex(iq, info, ctx))
+		return -1;
+
+	a = cos(info->frequency);
+	b = sin(info->frequency);
+	c = cos(info->phase) * info->magnitude;
+	s = sin(info->phase) * info->magnitude;
+
+	for (n = 0; n < ctx->size; n++) {
+		const double new_c = a * c - b * s;
+		const double new_s = b * c + a * s;
+		iq[n * 2] -= c;
+		iq[n * 2 + 1] -= s;
+		c = new_c;
+		s = new_s;
+	}
+
+	if (ctx->resuidal_cb)
+		ctx->resuidal_cb(iq, ctx->size * 2, ctx->user_ctx);
+
+	return 0;
+}
+
+/*
+ * Analysis for extraction: the sine is synthesized for subtraction anyway, so all
+ * fields are computed, tmp_buf holds the sine unless fast estimation is used
+ */
+static void gha_analyze_extract(const FLOAT* pcm, struct gha_info* info, gha_ctx_t ctx)
+{
+	ctx->kernels->frame.window(pcm, ctx->window, ctx->size, ctx->tmp_buf);
+	gha_analyze_windowed(pcm, info, GHA_FIELDS_ALL, ctx);
+}
+
+/*
+ * Subtract the component found by gha_analyze_extract
+ */
+static void gha_subtract_extracted(FLOAT* pcm, const struct gha_info* info, gha_ctx_t ctx)
+{
+	size_t i;
+	const FLOAT magnitude = info->magnitude;
+
+	/* fast estimation does not synthesize the sine */
+	if (ctx->quality == GHA_QUALITY_FAST)
+		ctx->kernels->frame.sine(ctx->tmp_buf, ctx->size, info->frequency, info->phase);
+
+	for (i = 0; i < ctx->size; i++)
+		pcm[i] -= ctx->tmp_buf[i] * magnitude;
+
+	if (ctx->resuidal_cb)
+		ctx->resuidal_cb(pcm, ctx->size, ctx->user_ctx);
+}
+
+int gha_extract_one(FLOAT* pcm, struct gha_info* info, gha_ctx_t ctx)
+{
+	if (gha_gated(pcm, 1, info, ctx))
+		return GHA_NO_COMPONENT;
+
+	gha_analyze_extract(pcm, info, ctx);
+	gha_subtract_extracted(pcm, info, ctx);
+	return 0;
+}
+
+/*
+ * Extracts up to k components, stops once the residual is below the energy gate,
+ * the rest of info is zeroed. Returns number of extracted components.
+ */
+static size_t gha_extract_gated(FLOAT* pcm, struct gha_info* info, size_t k, gha_ctx_t ctx)
+{
+	size_t n;
+
+	for (n = 0; n < k; n++) {
+		if (gha_extract_one(pcm, info + n, ctx) == GHA_NO_COMPONENT)
+			break;
+	}
+
+	gha_no_component(info + n, k - n);
+	return n;
+}
+
+void gha_extract_many_simple(FLOAT* pcm, struct gha_info* info, size_t k, gha_ctx_t ctx)
+{
+	gha_extract_gated(pcm, info, k, ctx);
+}
+
+/*
+ * Criterion decides if component with energy drop is accepted, energy is the
+ * residual energy before it. Information criteria compare size * ln(energy / size)
+ * + penalty with and without the component: 2 per parameter (3 parameters) for AIC,
+ * ln(size) / 2 per parameter for MDL where frequency counts as 3 parameters as it is
+ * estimated with size^(3/2) precision.
+ */
+static int gha_stop_accept(const struct gha_stop_criterion* stop, double energy, double drop, size_t size)
+{
+	const double left = energy - drop > 0 ? energy - drop : 0;
+
+	switch (stop->rule) {
+	case GHA_STOP_SNR:
+		/* checked before analysis */
+		return 1;
+	case GHA_STOP_DROP:
+		return drop >= stop->threshold * energy;
+	case GHA_STOP_AIC:
+		return left > 0 && size * log(left / energy) + 2 * 3 < 0;
+	case GHA_STOP_MDL:
+		/*
+		 * 5, not 3: code length of a parameter is ln(1 / precision), frequency
+		 * precision is size^(-3/2) against size^(-1/2) of magnitude and phase
+		 */
+		return left > 0 && size * log(left / energy) + 0.5 * 5 * log(size) < 0;
+	}
+
+	return 0;
+}
+
+size_t gha_extract_until(FLOAT* pcm, struct gha_info* info, size_t max_k, const struct gha_stop_criterion* stop, gha_ctx_t ctx)
+{
+	size_t i, k;
+	double total = 0;
+	double energy;
+
+	for (i = 0; i < ctx->size; i++)
+		total += pcm[i] * pcm[i];
+	energy = total;
+
+	/* the gate is checked on the tracked energy, no pass is needed */
+	for (k = 0; k < max_k && energy > 0 && energy >= ctx->gate; k++) {
+		double drop;
+
+		/* extracted energy to the residual one */
+		if (stop->rule == GHA_STOP_SNR && 10 * log10((total - energy) / energy) >= stop->threshold)
+			break;
+
+		gha_analyze_extract(pcm, info + k, ctx);
+
+		/*
+		 * Least squares fit removes magnitude^2 * |sine|^2, the same is assumed
+		 * for fast estimation
+		 */
+		drop = info[k].magnitude * info[k].magnitude * gha_sine_energy(ctx->size, info[k].frequency, info[k].phase);
+		if (!gha_stop_accept(stop, energy, drop, ctx->size))
+			break;
+
+		gha_subtract_extracted(pcm, info + k, ctx);
+		energy = energy > drop ? energy - drop : 0;
+	}
+
+	gha_no_component(info + k, max_k - k);
+	return k;
+}
+
+int gha_adjust_info(const FLOAT* pcm, struct gha_info* info, size_t k, gha_ctx_t ctx)
+{
+	int rv = gha_adjust_info_newton_md(pcm, info, k, ctx);
+	if (ctx->resuidal_cb)
+		ctx->resuidal_cb(ctx->tmp_buf, ctx->size, ctx->user_ctx);
+
+	return rv;
+}
+
+int gha_extract_many_adjusted(const FLOAT* pcm, FLOAT* residual, struct gha_info* info, size_t k, gha_ctx_t ctx)
+{
+	int rv = 0;
+	/* extraction works on the residual, adjustment uses it as scratch */
+	FLOAT* res = residual ? residual : ctx->raw_buf;
+
+	memcpy(res, pcm, sizeof(FLOAT) * ctx->size);
+	k = gha_extract_gated(res, info, k, ctx);
+
+	if (k)
+		rv = gha_adjust_newton(pcm, info, k, res, 0, ctx);
+
+	gha_add_info(pcm, info, k, -1.0, res, ctx->size);
+	if (ctx->resuidal_cb)
+		ctx->resuidal_cb(res, ctx->size, ctx->user_ctx);
+
+	return rv;
+}
+
+/*
+ * Adjusts component i of count together with up to neighbours nearest to it
+ * in frequency, pcm holds the residual of all count components
+ */
+static int gha_adjust_local(FLOAT* pcm, struct gha_info* info, size_t i, size_t count, size_t neighbours, gha_ctx_t ctx)
+{
+	size_t j, l;
+	size_t m = 1;
+	size_t idx[GHA_LOCAL_MAX_NEIGHBOURS + 1];
+	struct gha_info local[GHA_LOCAL_MAX_NEIGHBOURS + 1];
+	int rv;
+
+	if (neighbours > GHA_LOCAL_MAX_NEIGHBOURS)
+		neighbours = GHA_LOCAL_MAX_NEIGHBOURS;
+
+	/* insertion into the list sorted by distance, the component itself is the first */
+	idx[0] = i;
+	for (j = 0; j < count; j++) {
+		const FLOAT d = fabs(info[j].frequency - info[i].frequency);
+
+		if (j == i)
+			continue;
+
+		if (m <= neighbours)
+			m++;
+		else if (d >= fabs(info[idx[m - 1]].frequency - info[i].frequency))
+			continue;
+
+		for (l = m - 1; l > 1 && fabs(info[idx[l - 1]].frequency - info[i].frequency) > d; l--)
+			idx[l] = idx[l - 1];
+		idx[l] = j;
+	}
+
+	if (m == 1)
+		return 0;
+
+	for (l = 0; l < m; l++)
+		local[l] = info[idx[l]];
+
+	/* put the group back, adjust it over the local signal and remove again */
+	gha_add_info(pcm, local, m, 1.0, pcm, ctx->size);
+	rv = gha_adjust_newton(pcm, local, m, ctx->tmp_buf, 1, ctx);
+	gha_add_info(pcm, local, m, -1.0, pcm, ctx->size);
+
+	for (l = 0; l < m; l++)
+		info[idx[l]] = local[l];
+
+	return rv;
+}
+
+int gha_extract_many_local(FLOAT* pcm, struct gha_info* info, size_t k, size_t neighbours, gha_ctx_t ctx)
+{
+	size_t i;
+	int rv = 0;
+
+	for (i = 0; i < k; i++) {
+		if (gha_extract_one(pcm, info + i, ctx) == GHA_NO_COMPONENT)
+			break;
+		if (gha_adjust_local(pcm, info, i, i + 1, neighbours, ctx))
+			rv = -1;
+	}
+
+	gha_no_component(info + i, k - i);
+	k = i;
+
+	/* the early groups are adjusted once more with all the components known */
+	for (i = 0; i < k; i++) {
+		if (gha_adjust_local(pcm, info, i, k, neighbours, ctx))
+			rv = -1;
+	}
+
+	if (ctx->resuidal_cb)
+		ctx->resuidal_cb(pcm, ctx->size, ctx->user_ctx);
+
+	return rv;
+}
+
+/*
+ * Power of x spectrum at omega, Goertzel algorithm
+ */
+static double gha_goertzel_power(const FLOAT* x, size_t size, double omega)
+{
+	size_t n;
+	const double k = 2 * cos(omega);
+	double s1 = 0, s2 = 0;
+
+	for (n = 0; n < size; n++) {
+		const double s0 = x[n] + k * s1 - s2;
+		s2 = s1;
+		s1 = s0;
+	}
+
+	return s1 * s1 + s2 * s2 - k * s1 * s2;
+}
+
+/*
+ * Initial fundamental: the strongest component is some harmonic h <= k of it,
+ * the candidate omega / h with the biggest windowed spectrum power summed over
+ * its k harmonics wins. Subharmonic candidates hit the same partials when k is
+ * above the number of partials present, so a candidate with higher h has to be
+ * GHA_HARMONIC_MARGIN times stronger.
+ */
+static double gha_harmonic_start(const FLOAT* pcm, double omega, size_t k, gha_ctx_t ctx)
+{
+	size_t h, m;
+	double best = 0;
+	double f0 = omega;
+
+	for (m = 0; m < ctx->size; m++)
+		ctx->raw_buf[m] = pcm[m] * ctx->window[m];
+
+	for (h = 1; h <= k; h++) {
+		const double f = omega / h;
+		double score = 0;
+
+		for (m = 1; m <= k && m * f < M_PI; m++)
+			score += gha_goertzel_power(ctx->raw_buf, ctx->size, m * f);
+
+		if (h == 1 || score > best * GHA_HARMONIC_MARGIN) {
+			best = score;
+			f0 = f;
+		}
+	}
+
+	return f0;
+}
+
+int gha_extract_harmonic(FLOAT* pcm, struct gha_info* info, size_t k, gha_ctx_t ctx)
+{
+	size_t loop, h, i, j, n, harmonics;
+	struct gha_info peak;
+	double f0, hi;
+	size_t dim, col;
+	double *M, *v, *x;
+	int rv = 0;
+
+	if (k == 0)
+		return 0;
+
+	if (gha_gated(pcm, 1, info, ctx)) {
+		gha_no_component(info, k);
+		return GHA_NO_COMPONENT;
+	}
+
+	gha_analyze_extract(pcm, &peak, ctx);
+	f0 = gha_harmonic_start(pcm, peak.frequency, k, ctx);
+
+	for (harmonics = 1; harmonics < k && (harmonics + 1) * f0 < M_PI; harmonics++)
+		;
+	hi = M_PI / harmonics;
+
+	/* f0 * size, cos and sin coefficients of each harmonic */
+	dim = 2 * harmonics + 1;
+	col = dim + 1;
+	M = malloc(sizeof(double) * (dim * col + dim * 2));
+	if (!M)
+		return -1;
+	v = M + dim * col;
+	x = v + dim;
+	memset(x, 0, sizeof(double) * dim);
+
+	/*
+	 * Gauss-Newton on the model sum of a[h] * cos(h * f0 * n) + b[h] * sin(h * f0 * n),
+	 * linear in a and b. The first step starts from zero amplitudes, f0 is fixed
+	 * then (its derivative is zero) and the step is plain linear least squares.
+	 */
+	for (loop = 0; loop <= GHA_ADJUST_LOOPS; loop++) {
+		const size_t first = loop ? 0 : 1;
+		const double ra = cos(f0), rb = sin(f0);
+		double rc = 1, rs = 0;
+		double c[harmonics], s[harmonics];
+		double max = 0, step = 0;
+
+		memset(M, 0, sizeof(double) * dim * col);
+
+		for (n = 0; n < ctx->size; n++) {
+			double r = pcm[n];
+			double d = 0;
+
+			/* cos and sin of h * f0 * n from the ones of f0 * n */
+			c[0] = rc;
+			s[0] = rs;
+			for (h = 1; h < harmonics; h++) {
+				c[h] = c[h - 1] * rc - s[h - 1] * rs;
+				s[h] = s[h - 1] * rc + c[h - 1] * rs;
+			}
+
+			for (h = 0; h < harmonics; h++) {
+				const double a = x[1 + h], b = x[1 + harmonics + h];
+				r -= a * c[h] + b * s[h];
+				d += (h + 1) * (b * c[h] - a * s[h]);
+			}
+
+			v[0] = d * n / ctx->size;
+			for (h = 0; h < harmonics; h++) {
+				v[1 + h] = c[h];
+				v[1 + harmonics + h] = s[h];
+			}
+
+			for (i = first; i < dim; i++) {
+				for (j = i; j < dim; j++)
+					M[i * col + j] += v[i] * v[j];
+				M[i * col + dim] += v[i] * r;
+			}
+
+			{
+				const double new_c = ra * rc - rb * rs;
+				const double new_s = rb * rc + ra * rs;
+				rc = new_c;
+				rs = new_s;
+			}
+		}
+
+		/* the system without excluded f0 row and column starts at M[first][first] */
+		for (i = first; i < dim; i++)
+			for (j = first; j < i; j++)
+				M[i * col + j] = M[j * col + i];
+		for (i = first; i < dim; i++)
+			memmove(M + (i - first) * (col - first), M + i * col + first, sizeof(double) * (col - first));
+
+		if (sle_solve(M, dim - first, v + first)) {
+			rv = -1;
+			break;
+		}
+		if (first)
+			v[0] = 0;
+
+		for (i = 1; i < dim; i++) {
+			x[i] += v[i];
+			max = fabs(x[i]) > max ? fabs(x[i]) : max;
+			step = fabs(v[i]) > step ? fabs(v[i]) : step;
+		}
+		f0 += v[0] / ctx->size;
+		newton_clamp(&f0, 0, hi);
+
+		if (loop && fabs(v[0]) * harmonics < GHA_ADJUST_TOLERANCE && step <= max * GHA_ADJUST_TOLERANCE)
+			break;
+	}
+
+	/* a * cos + b * sin = magnitude * sin(+ phase) */
+	for (h = 0; h < harmonics; h++) {
+		const double a = x[1 + h], b = x[1 + harmonics + h];
+		const double phase = atan2(a, b);
+
+		info[h].frequency = (h + 1) * f0;
+		info[h].phase = phase < 0 ? phase + 2 * M_PI : phase;
+		info[h].magnitude = sqrt(a * a + b * b);
+	}
+	gha_no_component(info + harmonics, k - harmonics);
+
+	free(M);
+
+	gha_add_info(pcm, info, harmonics, -1.0, pcm, ctx->size);
+	if (ctx->resuidal_cb)
+		ctx->resuidal_cb(pcm, ctx->size, ctx->user_ctx);
 
 	return rv;
 }
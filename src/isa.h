@@ -0,0 +1,67 @@
+#ifndef ISA_H
+#define ISA_H
+
+/*
+ * Kernel sources (fft, fft_r4, fft_bluestein, batch, pcm, peaks, frame, kernels) are compiled
+ * once with the build flags and once more for each additional instruction
+ * set with GHA_KERNEL_LEVEL defined to the level name (e.g. avx2). The
+ * name is appended to all external kernel symbols so the variants can be
+ * linked together and selected at runtime, see kernels.h.
+ */
+
+#ifdef GHA_KERNEL_LEVEL
+#	define ISA_CAT_(a, b) a##b
+#	define ISA_CAT(a, b) ISA_CAT_(a, b)
+#	define ISA_STR_(a) #a
+#	define ISA_STR(a) ISA_STR_(a)
+#	define ISA_NAME(name) ISA_CAT(ISA_CAT(name, _), GHA_KERNEL_LEVEL)
+
+#	define fft_alloc ISA_NAME(fft_alloc)
+#	define fft_free ISA_NAME(fft_free)
+#	define fft_real ISA_NAME(fft_real)
+#	define fft_alloc_cpx ISA_NAME(fft_alloc_cpx)
+#	define fft_cpx ISA_NAME(fft_cpx)
+#	define fft_batch_lanes ISA_NAME(fft_batch_lanes)
+#	define fft_real_batch ISA_NAME(fft_real_batch)
+#	define fft_next_fast_size ISA_NAME(fft_next_fast_size)
+
+#	define fft_r4_supported ISA_NAME(fft_r4_supported)
+#	define fft_r4_alloc ISA_NAME(fft_r4_alloc)
+#	define fft_r4_free ISA_NAME(fft_r4_free)
+#	define fft_r4_real ISA_NAME(fft_r4_real)
+#	define fft_r4_batch_lanes ISA_NAME(fft_r4_batch_lanes)
+#	define fft_r4_real_batch ISA_NAME(fft_r4_real_batch)
+#	define fft_r4_cpx_supported ISA_NAME(fft_r4_cpx_supported)
+#	define fft_r4_alloc_cpx ISA_NAME(fft_r4_alloc_cpx)
+#	define fft_r4_cpx ISA_NAME(fft_r4_cpx)
+#	define fft_r4_init_post ISA_NAME(fft_r4_init_post)
+#	define fft_r4_post ISA_NAME(fft_r4_post)
+
+#	define fft_bluestein_preferred ISA_NAME(fft_bluestein_preferred)
+#	define fft_bluestein_alloc ISA_NAME(fft_bluestein_alloc)
+#	define fft_bluestein_free ISA_NAME(fft_bluestein_free)
+#	define fft_bluestein_real ISA_NAME(fft_bluestein_real)
+#	define fft_bluestein_alloc_cpx ISA_NAME(fft_bluestein_alloc_cpx)
+#	define fft_bluestein_cpx ISA_NAME(fft_bluestein_cpx)
+
+#	define batch_lanes ISA_NAME(batch_lanes)
+#	define batch_window ISA_NAME(batch_window)
+#	define batch_argmax ISA_NAME(batch_argmax)
+#	define batch_newton ISA_NAME(batch_newton)
+#	define batch_magnitude ISA_NAME(batch_magnitude)
+#	define batch_goertzel ISA_NAME(batch_goertzel)
+
+#	define pcm_window ISA_NAME(pcm_window)
+#	define pcm_energy ISA_NAME(pcm_energy)
+
+#	define peaks_find ISA_NAME(peaks_find)
+
+#	define frame_window ISA_NAME(frame_window)
+#	define frame_newton ISA_NAME(frame_newton)
+#	define frame_sine ISA_NAME(frame_sine)
+#	define frame_fit ISA_NAME(frame_fit)
+
+#	define kernels_table ISA_NAME(kernels_table)
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+#include "kernels.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const struct kernels kernels_table = {
+#ifdef GHA_KERNEL_LEVEL
+	ISA_STR(GHA_KERNEL_LEVEL),
+#else
+	"generic",
+#endif
+	{
+		fft_alloc,
+		fft_free,
+		fft_real,
+		fft_alloc_cpx,
+		fft_cpx,
+		fft_batch_lanes,
+		fft_real_batch,
+		fft_next_fast_size
+	},
+	{
+		batch_lanes,
+		batch_window,
+		batch_argmax,
+		batch_newton,
+		batch_magnitude,
+		batch_goertzel
+	},
+	{
+		pcm_window,
+		pcm_energy
+	},
+	{
+		peaks_find
+	},
+	{
+		frame_window,
+		frame_newton,
+		frame_sine,
+		frame_fit
+	}
+};
+
+#ifndef GHA_KERNEL_LEVEL
+
+#include <stdio.h>
+#include <pthread.h>
+
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+static const struct kernels* kernels_selected;
+
+/*
+ * The best table supported by the cpu or the one forced by GHA_CPU,
+ * a warning is printed once for a value which can not be used
+ */
+static const struct kernels* kernels_detect(void)
+{
+	const struct kernels* best = &kernels_table;
+	const char* force = getenv("GHA_CPU");
+
+#ifdef GHA_KERNELS_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		best = &kernels_table_avx2;
+#endif
+
+	if (!force)
+		return best;
+
+	if (strcmp(force, kernels_table.name) == 0)
+		return &kernels_table;
+
+#ifdef GHA_KERNELS_AVX2
+	if (strcmp(force, kernels_table_avx2.name) == 0) {
+		if (best != &kernels_table_avx2)
+			fprintf(stderr, "libgha: GHA_CPU=%s is not supported by the cpu, %s is used\n", force, best->name);
+		return best;
+	}
+#endif
+
+	fprintf(stderr, "libgha: unknown GHA_CPU=%s, %s is used\n", force, best->name);
+	return best;
+}
+
+static void kernels_init(void)
+{
+	kernels_selected = kernels_detect();
+}
+
+const struct kernels* kernels_select(void)
+{
+	pthread_once(&kernels_once, kernels_init);
+
+	return kernels_selected;
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "fft.h"
+#include "batch.h"
+#include "pcm.h"
+#include "peaks.h"
+#include "frame.h"
+
+/*
+ * Table of hot kernels compiled for one instruction set.
+ *
+ * The table is selected once (thread safe), at first gha_create_ctx, as the
+ * best one supported by the host cpu. GHA_CPU environment variable can be used
+ * to force lower level: "generic" (build flags) or "avx2" (x86 builds with
+ * GHA_RUNTIME_DISPATCH), other values and levels not supported by the cpu are
+ * ignored with a warning on stderr. Objects created by one table (e.g. struct
+ * fft) must be used only with the same table.
+ */
+
+struct kernels {
+	const char* name;
+	struct {
+		struct fft* (*alloc)(size_t size);
+		void (*free)(struct fft* fft);
+		void (*real)(struct fft* fft, const FLOAT* in, kiss_fft_cpx* out);
+		struct fft* (*alloc_cpx)(size_t size);
+		void (*cpx)(struct fft* fft, const kiss_fft_cpx* in, kiss_fft_cpx* out);
+		size_t (*batch_lanes)(struct fft* fft);
+		void (*real_batch)(struct fft* fft, const FLOAT* in, FLOAT* out_re, FLOAT* out_im, FLOAT* work);
+		size_t (*next_fast_size)(size_t n);
+	} fft;
+	struct {
+		size_t (*lanes)(void);
+		void (*window)(const FLOAT* const* pcm, size_t stride, size_t count, const FLOAT* window, size_t size, size_t padded_size, FLOAT* out, FLOAT* raw);
+		void (*argmax)(const FLOAT* re, const FLOAT* im, size_t bins, size_t* out);
+		void (*newton)(const FLOAT* x, size_t size, size_t count, double omega_min, double omega_max, double* omega, double* phase);
+		void (*magnitude)(const FLOAT* x, size_t size, size_t count, const double* omega, const double* phase, double* magnitude);
+		void (*goertzel)(const FLOAT* x, size_t size, const FLOAT* omega, size_t k, FLOAT* power, FLOAT* energy);
+	} batch;
+	struct {
+		void (*window)(const void* in, enum pcm_format format, const FLOAT* window, size_t size, FLOAT* raw, FLOAT* out);
+		double (*energy)(const FLOAT* x, size_t size);
+	} pcm;
+	struct {
+		size_t (*find)(const kiss_fft_cpx* bins, size_t first, size_t last, FLOAT threshold, const unsigned char* mask,
+			size_t k, FLOAT* power, size_t* index, FLOAT* value);
+	} peaks;
+	struct {
+		void (*window)(const FLOAT* pcm, const FLOAT* window, size_t size, FLOAT* out);
+		void (*newton)(const FLOAT* x, double omega, size_t size, double omega_min, double omega_max,
+			size_t max_loops, struct gha_info* result);
+		void (*sine)(FLOAT* buf, size_t size, FLOAT omega, FLOAT phase);
+		double (*fit)(const FLOAT* x, const FLOAT* sine, size_t size);
+	} frame;
+};
+
+/*
+ * Table of this build level, avx2 level table when built with GHA_KERNELS_AVX2
+ */
+extern const struct kernels kernels_table;
+#ifdef GHA_KERNELS_AVX2
+extern const struct kernels kernels_table_avx2;
+#endif
+
+const struct kernels* kernels_select(void);
+
+#endif
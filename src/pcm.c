@@ -0,0 +1,143 @@
+#include "pcm.h"
+#include "simd.h"
+
+#include <stdint.h>
+
+/* samples decoded at once, multiple of any VR_LANES */
+#define PCM_BLOCK 64
+
+/*
+ * G.711 decoders, return 16 bit linear sample
+ */
+static inline int32_t pcm_ulaw(uint8_t u)
+{
+	int32_t t;
+
+	u = ~u;
+	t = ((u & 0x0f) << 3) + 0x84;
+	t <<= (u & 0x70) >> 4;
+
+	return (u & 0x80) ? 0x84 - t : t - 0x84;
+}
+
+static inline int32_t pcm_alaw(uint8_t a)
+{
+	int32_t t;
+	int seg;
+
+	a ^= 0x55;
+	t = (a & 0x0f) << 4;
+	seg = (a & 0x70) >> 4;
+	if (seg == 0)
+		t += 8;
+	else
+		t = (t + 0x108) << (seg - 1);
+
+	return (a & 0x80) ? t : -t;
+}
+
+static FLOAT pcm_scale(enum pcm_format format)
+{
+	switch (format) {
+	case PCM_S24:
+		return 1.0 / (1 << 23);
+	case PCM_S32:
+		return 1.0 / 2147483648.0;
+	case PCM_U8:
+		return 1.0 / (1 << 7);
+	default:
+		return 1.0 / (1 << 15);
+	}
+}
+
+/*
+ * Decode n samples starting from sample i in to 32 bit integers
+ */
+static void pcm_decode(const void* in, enum pcm_format format, size_t i, size_t n, int32_t* out)
+{
+	size_t j;
+	const uint8_t* b = (const uint8_t*)in;
+	const int16_t* s16 = (const int16_t*)in;
+
+	switch (format) {
+	case PCM_S16:
+		for (j = 0; j < n; j++)
+			out[j] = s16[i + j];
+		break;
+	case PCM_S24:
+		for (j = 0; j < n; j++) {
+			const uint8_t* p = b + (i + j) * 3;
+			int32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+			out[j] = (v ^ 0x800000) - 0x800000;
+		}
+		break;
+	case PCM_U8:
+		for (j = 0; j < n; j++)
+			out[j] = b[i + j] - 128;
+		break;
+	case PCM_ULAW:
+		for (j = 0; j < n; j++)
+			out[j] = pcm_ulaw(b[i + j]);
+		break;
+	case PCM_ALAW:
+		for (j = 0; j < n; j++)
+			out[j] = pcm_alaw(b[i + j]);
+		break;
+	case PCM_S32:
+		break;
+	}
+}
+
+void pcm_window(const void* in, enum pcm_format format, const FLOAT* window, size_t size, FLOAT* raw, FLOAT* out)
+{
+	size_t i, j, n;
+	int32_t buf[PCM_BLOCK];
+	const FLOAT scale = pcm_scale(format);
+	const vr_t vscale = vr_set1(scale);
+
+	for (i = 0; i < size; i += PCM_BLOCK) {
+		const int32_t* x = buf;
+		n = size - i < PCM_BLOCK ? size - i : PCM_BLOCK;
+
+		if (format == PCM_S32)
+			x = (const int32_t*)in + i;
+		else
+			pcm_decode(in, format, i, n, buf);
+
+		for (j = 0; j + VR_LANES <= n; j += VR_LANES) {
+			vr_t v = vr_mul(vr_load_i32(x + j), vscale);
+			vr_store(raw + i + j, v);
+			vr_store(out + i + j, vr_mul(v, vr_load(window + i + j)));
+		}
+		for (; j < n; j++) {
+			raw[i + j] = x[j] * scale;
+			out[i + j] = raw[i + j] * window[i + j];
+		}
+	}
+}
+
+double pcm_energy(const FLOAT* x, size_t size)
+{
+	size_t i, l;
+	FLOAT acc[VR_LANES];
+	vr_t s0 = vr_zero();
+	vr_t s1 = vr_zero();
+	double sum = 0;
+
+	/* two accumulators to hide add latency */
+	for (i = 0; i + 2 * VR_LANES <= size; i += 2 * VR_LANES) {
+		const vr_t a = vr_load(x + i);
+		const vr_t b = vr_load(x + i + VR_LANES);
+		s0 = vr_add(s0, vr_mul(a, a));
+		s1 = vr_add(s1, vr_mul(b, b));
+	}
+
+	vr_store(acc, vr_add(s0, s1));
+	for (l = 0; l < VR_LANES; l++)
+		sum += acc[l];
+
+	for (; i < size; i++)
+		sum += x[i] * x[i];
+
+	return sum;
+}
@@ -0,0 +1,34 @@
+#ifndef PCM_H
+#define PCM_H
+
+#include "isa.h"
+
+#include <include/libgha.h>
+
+/*
+ * Integer sample formats accepted by gha_analyze_one_* functions.
+ * Samples are scaled to [-1, 1): s16 by 2^15, s24 (packed little endian)
+ * by 2^23, s32 by 2^31, u8 is offset by 128 and scaled by 2^7,
+ * G.711 mu-law and A-law are decoded to 16 bit linear and scaled by 2^15.
+ */
+enum pcm_format {
+	PCM_S16,
+	PCM_S24,
+	PCM_S32,
+	PCM_U8,
+	PCM_ULAW,
+	PCM_ALAW
+};
+
+/*
+ * Convert size samples of given format: scaled samples are written in to raw,
+ * scaled samples multiplied by window in to out.
+ */
+void pcm_window(const void* in, enum pcm_format format, const FLOAT* window, size_t size, FLOAT* raw, FLOAT* out);
+
+/*
+ * Sum of squares of size samples
+ */
+double pcm_energy(const FLOAT* x, size_t size);
+
+#endif
@@ -0,0 +1,78 @@
+#include "peaks.h"
+#include "simd.h"
+
+/*
+ * Insert peak i in to sorted list of n (< k or the last one is dropped),
+ * returns new number of peaks
+ */
+static size_t peaks_insert(size_t i, FLOAT p, size_t n, size_t k, size_t* index, FLOAT* value)
+{
+	size_t j = n < k ? n : k - 1;
+
+	for (; j > 0 && value[j - 1] < p; j--) {
+		index[j] = index[j - 1];
+		value[j] = value[j - 1];
+	}
+	index[j] = i;
+	value[j] = p;
+
+	return n < k ? n + 1 : n;
+}
+
+size_t peaks_find(const kiss_fft_cpx* bins, size_t first, size_t last, FLOAT threshold, const unsigned char* mask,
+	size_t k, FLOAT* power, size_t* index, FLOAT* value)
+{
+	size_t i, l;
+	size_t n = 0;
+	/* the weakest peak to be accepted: threshold or the k-th found one */
+	FLOAT min = threshold;
+	vr_t vmin = vr_set1(min);
+
+	if (k == 0 || first > last)
+		return 0;
+
+	for (i = first; i + VR_LANES <= last + 1; i += VR_LANES) {
+		vr_t r, im;
+		const FLOAT* b = (const FLOAT*)(bins + i);
+		vr_deinterleave2(vr_load(b), vr_load(b + VR_LANES), &r, &im);
+		vr_store(power + i, vr_add(vr_mul(r, r), vr_mul(im, im)));
+	}
+	for (; i <= last; i++)
+		power[i] = bins[i].r * bins[i].r + bins[i].i * bins[i].i;
+
+	/* the range edges have one neighbour */
+	if (power[first] > min && (first == last || power[first] >= power[first + 1]) && !(mask && mask[first])) {
+		n = peaks_insert(first, power[first], n, k, index, value);
+		if (n == k)
+			min = value[k - 1];
+	}
+
+	/* interior bins, most of the groups have no peak above min */
+	for (i = first + 1; i + VR_LANES <= last; i += VR_LANES) {
+		const vr_t p = vr_load(power + i);
+		const vr_t peak = vr_and(vr_and(vr_gt(p, vr_load(power + i - 1)), vr_ge(p, vr_load(power + i + 1))), vr_gt(p, vmin));
+		int bits = vr_mask_bits(peak);
+
+		for (l = 0; bits; l++, bits >>= 1) {
+			if (!(bits & 1) || power[i + l] <= min || (mask && mask[i + l]))
+				continue;
+			n = peaks_insert(i + l, power[i + l], n, k, index, value);
+			if (n == k) {
+				min = value[k - 1];
+				vmin = vr_set1(min);
+			}
+		}
+	}
+	for (; i < last; i++) {
+		if (power[i] > min && power[i] > power[i - 1] && power[i] >= power[i + 1] && !(mask && mask[i])) {
+			n = peaks_insert(i, power[i], n, k, index, value);
+			if (n == k)
+				min = value[k - 1];
+		}
+	}
+
+	if (last > first && power[last] > min && power[last] > power[last - 1] && !(mask && mask[last]))
+		n = peaks_insert(last, power[last], n, k, index, value);
+
+	return n;
+}
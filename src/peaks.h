@@ -0,0 +1,22 @@
+#ifndef PEAKS_H
+#define PEAKS_H
+
+#include "isa.h"
+
+#include <include/libgha.h>
+
+#include <kiss_fft.h>
+
+/*
+ * Up to k strongest local maxima of power of bins in [first, last]: bins with
+ * power above threshold, above the previous bin and not below the next one,
+ * bins outside of the range are not compared. Bins with non zero mask[i] are
+ * skipped (mask may be null). Peaks are written in to index and value (power)
+ * sorted by power, the first bin wins among equal peaks.
+ * power - scratch of last + 1 values.
+ * Returns number of found peaks.
+ */
+size_t peaks_find(const kiss_fft_cpx* bins, size_t first, size_t last, FLOAT threshold, const unsigned char* mask,
+	size_t k, FLOAT* power, size_t* index, FLOAT* value);
+
+#endif
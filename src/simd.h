@@ -0,0 +1,366 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <include/libgha.h>
+
+/*
+ * Minimal vector abstraction over FLOAT used by the hot kernels.
+ *
+ * vr_t holds VR_LANES values of FLOAT. The implementation is selected by
+ * the instruction set the translation unit is compiled for, scalar code
+ * (one lane) is used if no suitable extension is available.
+ *
+ * All loads and stores are unaligned. Comparison returns lane mask
+ * which can be used only with vr_select, vr_and and vr_mask_bits (bit l
+ * of the result is set if lane l is set). vr_load_i32 loads VR_LANES
+ * int32_t values converted to FLOAT.
+ */
+
+#if defined(GHA_USE_DOUBLE_API)
+#	if defined(__AVX__)
+#		define GHA_SIMD_AVX_PD
+#	elif defined(__SSE2__)
+#		define GHA_SIMD_SSE2_PD
+#	endif
+#else
+#	if defined(__AVX__)
+#		define GHA_SIMD_AVX_PS
+#	elif defined(__SSE2__)
+#		define GHA_SIMD_SSE_PS
+#	endif
+#endif
+
+#if defined(GHA_SIMD_AVX_PS) || defined(GHA_SIMD_AVX_PD)
+#	include <immintrin.h>
+#elif defined(GHA_SIMD_SSE_PS) || defined(GHA_SIMD_SSE2_PD)
+#	include <emmintrin.h>
+#endif
+
+#if defined(GHA_SIMD_AVX_PS)
+
+typedef __m256 vr_t;
+#define VR_LANES 8
+
+#define vr_load(p) _mm256_loadu_ps(p)
+#define vr_store(p, v) _mm256_storeu_ps(p, v)
+#define vr_set1(x) _mm256_set1_ps(x)
+#define vr_zero() _mm256_setzero_ps()
+#define vr_add(a, b) _mm256_add_ps(a, b)
+#define vr_sub(a, b) _mm256_sub_ps(a, b)
+#define vr_mul(a, b) _mm256_mul_ps(a, b)
+#define vr_max(a, b) _mm256_max_ps(a, b)
+#define vr_gt(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define vr_ge(a, b) _mm256_cmp_ps(a, b, _CMP_GE_OQ)
+#define vr_and(a, b) _mm256_and_ps(a, b)
+#define vr_mask_bits(m) _mm256_movemask_ps(m)
+#define vr_select(m, a, b) _mm256_blendv_ps(b, a, m)
+#define vr_load_i32(p) _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(p)))
+
+static inline vr_t vr_reverse(vr_t v)
+{
+	v = _mm256_permute2f128_ps(v, v, 1);
+	return _mm256_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+static inline void vr_interleave2(vr_t a, vr_t b, vr_t* lo, vr_t* hi)
+{
+	vr_t u = _mm256_unpacklo_ps(a, b);
+	vr_t v = _mm256_unpackhi_ps(a, b);
+	*lo = _mm256_permute2f128_ps(u, v, 0x20);
+	*hi = _mm256_permute2f128_ps(u, v, 0x31);
+}
+
+static inline void vr_deinterleave2(vr_t lo, vr_t hi, vr_t* a, vr_t* b)
+{
+	vr_t t0 = _mm256_permute2f128_ps(lo, hi, 0x20);
+	vr_t t1 = _mm256_permute2f128_ps(lo, hi, 0x31);
+	*a = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(2, 0, 2, 0));
+	*b = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+/*
+ * Halves of 4 lanes: broadcast lo to the low half and hi to the high one,
+ * interleave halves of a, b, c, d: out is a.lo b.lo, c.lo d.lo, a.hi b.hi, c.hi d.hi
+ */
+static inline vr_t vr_set1_halves(FLOAT lo, FLOAT hi)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(lo)), _mm_set1_ps(hi), 1);
+}
+
+static inline void vr_interleave_halves(vr_t a, vr_t b, vr_t c, vr_t d, vr_t* out)
+{
+	out[0] = _mm256_permute2f128_ps(a, b, 0x20);
+	out[1] = _mm256_permute2f128_ps(c, d, 0x20);
+	out[2] = _mm256_permute2f128_ps(a, b, 0x31);
+	out[3] = _mm256_permute2f128_ps(c, d, 0x31);
+}
+
+static inline void vr_interleave4(vr_t a, vr_t b, vr_t c, vr_t d, vr_t* out)
+{
+	vr_t t0 = _mm256_unpacklo_ps(a, b);
+	vr_t t1 = _mm256_unpackhi_ps(a, b);
+	vr_t t2 = _mm256_unpacklo_ps(c, d);
+	vr_t t3 = _mm256_unpackhi_ps(c, d);
+	vr_t u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	vr_t u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	vr_t u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	vr_t u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	vr_interleave_halves(u0, u1, u2, u3, out);
+}
+
+#elif defined(GHA_SIMD_SSE_PS)
+
+typedef __m128 vr_t;
+#define VR_LANES 4
+
+#define vr_load(p) _mm_loadu_ps(p)
+#define vr_store(p, v) _mm_storeu_ps(p, v)
+#define vr_set1(x) _mm_set1_ps(x)
+#define vr_zero() _mm_setzero_ps()
+#define vr_add(a, b) _mm_add_ps(a, b)
+#define vr_sub(a, b) _mm_sub_ps(a, b)
+#define vr_mul(a, b) _mm_mul_ps(a, b)
+#define vr_max(a, b) _mm_max_ps(a, b)
+#define vr_gt(a, b) _mm_cmpgt_ps(a, b)
+#define vr_ge(a, b) _mm_cmpge_ps(a, b)
+#define vr_and(a, b) _mm_and_ps(a, b)
+#define vr_mask_bits(m) _mm_movemask_ps(m)
+#define vr_select(m, a, b) _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b))
+#define vr_load_i32(p) _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(p)))
+
+static inline vr_t vr_reverse(vr_t v)
+{
+	return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+static inline void vr_interleave2(vr_t a, vr_t b, vr_t* lo, vr_t* hi)
+{
+	*lo = _mm_unpacklo_ps(a, b);
+	*hi = _mm_unpackhi_ps(a, b);
+}
+
+static inline void vr_deinterleave2(vr_t lo, vr_t hi, vr_t* a, vr_t* b)
+{
+	*a = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+	*b = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+static inline void vr_interleave4(vr_t a, vr_t b, vr_t c, vr_t d, vr_t* out)
+{
+	_MM_TRANSPOSE4_PS(a, b, c, d);
+	out[0] = a;
+	out[1] = b;
+	out[2] = c;
+	out[3] = d;
+}
+
+#elif defined(GHA_SIMD_AVX_PD)
+
+typedef __m256d vr_t;
+#define VR_LANES 4
+
+#define vr_load(p) _mm256_loadu_pd(p)
+#define vr_store(p, v) _mm256_storeu_pd(p, v)
+#define vr_set1(x) _mm256_set1_pd(x)
+#define vr_zero() _mm256_setzero_pd()
+#define vr_add(a, b) _mm256_add_pd(a, b)
+#define vr_sub(a, b) _mm256_sub_pd(a, b)
+#define vr_mul(a, b) _mm256_mul_pd(a, b)
+#define vr_max(a, b) _mm256_max_pd(a, b)
+#define vr_gt(a, b) _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define vr_ge(a, b) _mm256_cmp_pd(a, b, _CMP_GE_OQ)
+#define vr_and(a, b) _mm256_and_pd(a, b)
+#define vr_mask_bits(m) _mm256_movemask_pd(m)
+#define vr_select(m, a, b) _mm256_blendv_pd(b, a, m)
+#define vr_load_i32(p) _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(p)))
+
+static inline vr_t vr_reverse(vr_t v)
+{
+	v = _mm256_permute2f128_pd(v, v, 1);
+	return _mm256_permute_pd(v, 0x5);
+}
+
+static inline void vr_interleave2(vr_t a, vr_t b, vr_t* lo, vr_t* hi)
+{
+	vr_t u = _mm256_unpacklo_pd(a, b);
+	vr_t v = _mm256_unpackhi_pd(a, b);
+	*lo = _mm256_permute2f128_pd(u, v, 0x20);
+	*hi = _mm256_permute2f128_pd(u, v, 0x31);
+}
+
+static inline void vr_deinterleave2(vr_t lo, vr_t hi, vr_t* a, vr_t* b)
+{
+	vr_t t0 = _mm256_permute2f128_pd(lo, hi, 0x20);
+	vr_t t1 = _mm256_permute2f128_pd(lo, hi, 0x31);
+	*a = _mm256_unpacklo_pd(t0, t1);
+	*b = _mm256_unpackhi_pd(t0, t1);
+}
+
+static inline void vr_interleave4(vr_t a, vr_t b, vr_t c, vr_t d, vr_t* out)
+{
+	vr_t t0 = _mm256_unpacklo_pd(a, b);
+	vr_t t1 = _mm256_unpackhi_pd(a, b);
+	vr_t t2 = _mm256_unpacklo_pd(c, d);
+	vr_t t3 = _mm256_unpackhi_pd(c, d);
+	out[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+	out[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+	out[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+	out[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+#elif defined(GHA_SIMD_SSE2_PD)
+
+typedef __m128d vr_t;
+#define VR_LANES 2
+
+#define vr_load(p) _mm_loadu_pd(p)
+#define vr_store(p, v) _mm_storeu_pd(p, v)
+#define vr_set1(x) _mm_set1_pd(x)
+#define vr_zero() _mm_setzero_pd()
+#define vr_add(a, b) _mm_add_pd(a, b)
+#define vr_sub(a, b) _mm_sub_pd(a, b)
+#define vr_mul(a, b) _mm_mul_pd(a, b)
+#define vr_max(a, b) _mm_max_pd(a, b)
+#define vr_gt(a, b) _mm_cmpgt_pd(a, b)
+#define vr_ge(a, b) _mm_cmpge_pd(a, b)
+#define vr_and(a, b) _mm_and_pd(a, b)
+#define vr_mask_bits(m) _mm_movemask_pd(m)
+#define vr_select(m, a, b) _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b))
+#define vr_load_i32(p) _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(p)))
+
+static inline vr_t vr_reverse(vr_t v)
+{
+	return _mm_shuffle_pd(v, v, 1);
+}
+
+static inline void vr_interleave2(vr_t a, vr_t b, vr_t* lo, vr_t* hi)
+{
+	*lo = _mm_unpacklo_pd(a, b);
+	*hi = _mm_unpackhi_pd(a, b);
+}
+
+static inline void vr_deinterleave2(vr_t lo, vr_t hi, vr_t* a, vr_t* b)
+{
+	*a = _mm_unpacklo_pd(lo, hi);
+	*b = _mm_unpackhi_pd(lo, hi);
+}
+
+static inline void vr_interleave4(vr_t a, vr_t b, vr_t c, vr_t d, vr_t* out)
+{
+	out[0] = _mm_unpacklo_pd(a, b);
+	out[1] = _mm_unpacklo_pd(c, d);
+	out[2] = _mm_unpackhi_pd(a, b);
+	out[3] = _mm_unpackhi_pd(c, d);
+}
+
+#else
+
+typedef FLOAT vr_t;
+#define VR_LANES 1
+
+#define vr_load(p) (*(p))
+#define vr_store(p, v) (*(p) = (v))
+#define vr_set1(x) ((FLOAT)(x))
+#define vr_zero() ((FLOAT)0)
+#define vr_add(a, b) ((a) + (b))
+#define vr_sub(a, b) ((a) - (b))
+#define vr_mul(a, b) ((a) * (b))
+#define vr_max(a, b) ((a) > (b) ? (a) : (b))
+#define vr_gt(a, b) ((FLOAT)((a) > (b)))
+#define vr_ge(a, b) ((FLOAT)((a) >= (b)))
+#define vr_and(a, b) ((FLOAT)((a) != 0 && (b) != 0))
+#define vr_mask_bits(m) ((m) != 0)
+#define vr_select(m, a, b) ((m) != 0 ? (a) : (b))
+#define vr_load_i32(p) ((FLOAT)*(p))
+
+static inline vr_t vr_reverse(vr_t v)
+{
+	return v;
+}
+
+static inline void vr_interleave2(vr_t a, vr_t b, vr_t* lo, vr_t* hi)
+{
+	*lo = a;
+	*hi = b;
+}
+
+static inline void vr_deinterleave2(vr_t lo, vr_t hi, vr_t* a, vr_t* b)
+{
+	*a = lo;
+	*b = hi;
+}
+
+static inline void vr_interleave4(vr_t a, vr_t b, vr_t c, vr_t d, vr_t* out)
+{
+	out[0] = a;
+	out[1] = b;
+	out[2] = c;
+	out[3] = d;
+}
+
+#endif
+
+/*
+ * Double precision lanes used for accumulation.
+ * vd_load_r loads VD_LANES values of FLOAT and converts them to double.
+ */
+
+#if defined(__AVX__)
+
+typedef __m256d vd_t;
+#define VD_LANES 4
+
+#define vd_load(p) _mm256_loadu_pd(p)
+#define vd_store(p, v) _mm256_storeu_pd(p, v)
+#define vd_set1(x) _mm256_set1_pd(x)
+#define vd_zero() _mm256_setzero_pd()
+#define vd_add(a, b) _mm256_add_pd(a, b)
+#define vd_sub(a, b) _mm256_sub_pd(a, b)
+#define vd_mul(a, b) _mm256_mul_pd(a, b)
+#if defined(GHA_USE_DOUBLE_API)
+#	define vd_load_r(p) _mm256_loadu_pd(p)
+#else
+#	define vd_load_r(p) _mm256_cvtps_pd(_mm_loadu_ps(p))
+#endif
+
+#elif defined(__SSE2__)
+
+typedef __m128d vd_t;
+#define VD_LANES 2
+
+#define vd_load(p) _mm_loadu_pd(p)
+#define vd_store(p, v) _mm_storeu_pd(p, v)
+#define vd_set1(x) _mm_set1_pd(x)
+#define vd_zero() _mm_setzero_pd()
+#define vd_add(a, b) _mm_add_pd(a, b)
+#define vd_sub(a, b) _mm_sub_pd(a, b)
+#define vd_mul(a, b) _mm_mul_pd(a, b)
+#if defined(GHA_USE_DOUBLE_API)
+#	define vd_load_r(p) _mm_loadu_pd(p)
+#else
+#	define vd_load_r(p) _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)(p))))
+#endif
+
+#else
+
+typedef double vd_t;
+#define VD_LANES 1
+
+#define vd_load(p) (*(p))
+#define vd_store(p, v) (*(p) = (v))
+#define vd_set1(x) ((double)(x))
+#define vd_zero() (0.0)
+#define vd_add(a, b) ((a) + (b))
+#define vd_sub(a, b) ((a) - (b))
+#define vd_mul(a, b) ((a) * (b))
+#define vd_load_r(p) ((double)*(p))
+
+#endif
+
+static inline void vr_cmul(vr_t ar, vr_t ai, vr_t br, vr_t bi, vr_t* cr, vr_t* ci)
+{
+	*cr = vr_sub(vr_mul(ar, br), vr_mul(ai, bi));
+	*ci = vr_add(vr_mul(ar, bi), vr_mul(ai, br));
+}
+
+#endif
@@ -0,0 +1,329 @@
+#include <include/libgha.h>
+
+#include "decimate.h"
+#include "analysis.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* half band filter has 2 * SUBBAND_HALF_TAPS + 1 taps */
+#define SUBBAND_HALF_TAPS 32
+/* min number of samples of the lowest band */
+#define SUBBAND_MIN_SIZE 64
+/*
+ * Analysed range of each band relative to its Nyquist frequency: upper part of
+ * the half band filter transition is aliased above SUBBAND_HIGH after decimation,
+ * the lowest band starts at 0 and the highest one ends at pi
+ */
+#define SUBBAND_LOW 0.4
+#define SUBBAND_HIGH 0.8
+
+struct subband {
+	size_t size;
+	/* full rate position of the first sample and decimation factor */
+	size_t offset;
+	size_t factor;
+	/* analysed range in band units */
+	double omega_min;
+	double omega_max;
+	/* band signal, residual after extraction */
+	FLOAT* x;
+	gha_ctx_t ctx;
+	/* coarse estimation of the strongest component: full rate magnitude and band frequency */
+	FLOAT peak;
+	double omega;
+	/*
+	 * Refined component is at inner edge of the range, so it is leakage of
+	 * the neighbour band component, the band is skipped until the neighbour changes
+	 */
+	int blocked;
+};
+
+struct gha_subband {
+	size_t size;
+	size_t bands;
+	FLOAT taps[SUBBAND_HALF_TAPS + 1];
+	struct subband* band;
+};
+
+gha_subband_t gha_create_subband(size_t size, size_t bands)
+{
+	size_t b;
+	gha_subband_t sb;
+
+	if (bands == 0)
+		return NULL;
+
+	sb = malloc(sizeof(struct gha_subband));
+	if (!sb)
+		return NULL;
+
+	sb->band = calloc(bands, sizeof(struct subband));
+	if (!sb->band)
+		goto exit_free_sb;
+
+	sb->size = size;
+	sb->bands = bands;
+	decimate_filter(sb->taps, SUBBAND_HALF_TAPS, 2);
+
+	for (b = 0; b < bands; b++) {
+		struct subband* band = sb->band + b;
+
+		if (b == 0) {
+			band->size = size;
+			band->offset = 0;
+			band->factor = 1;
+		} else {
+			band->size = decimate_size(band[-1].size, SUBBAND_HALF_TAPS, 2);
+			band->offset = band[-1].offset + band[-1].factor * SUBBAND_HALF_TAPS;
+			band->factor = band[-1].factor * 2;
+		}
+
+		if (band->size < SUBBAND_MIN_SIZE && bands > 1)
+			goto exit_free_bands;
+
+		band->omega_min = b == bands - 1 ? 0 : SUBBAND_LOW * M_PI;
+		band->omega_max = b == 0 ? M_PI : SUBBAND_HIGH * M_PI;
+
+		band->x = malloc(sizeof(FLOAT) * band->size);
+		if (!band->x)
+			goto exit_free_bands;
+
+		band->ctx = gha_create_ctx(band->size);
+		if (!band->ctx)
+			goto exit_free_bands;
+
+		if (gha_set_fft_padding(1, band->ctx) || gha_set_band(band->omega_min, band->omega_max, band->ctx))
+			goto exit_free_bands;
+	}
+
+	return sb;
+exit_free_bands:
+	gha_free_subband(sb);
+	return NULL;
+exit_free_sb:
+	free(sb);
+	return NULL;
+}
+
+void gha_free_subband(gha_subband_t sb)
+{
+	size_t b;
+
+	for (b = 0; b < sb->bands; b++) {
+		if (sb->band[b].ctx)
+			gha_free_ctx(sb->band[b].ctx);
+		free(sb->band[b].x);
+	}
+
+	free(sb->band);
+	free(sb);
+}
+
+/*
+ * Gain of the filters from full rate to the band at full rate frequency omega
+ */
+static double subband_gain(gha_subband_t sb, size_t b, double omega)
+{
+	size_t l;
+	double g = 1.0;
+
+	for (l = 0; l < b; l++)
+		g *= decimate_response(sb->taps, SUBBAND_HALF_TAPS, omega * sb->band[l].factor);
+
+	return g;
+}
+
+/*
+ * x[n] -= sum of info[j].magnitude * sin(info[j].frequency * n + info[j].phase),
+ * the sines are produced by rotation, independent for each component
+ */
+static void subband_subtract(FLOAT* x, size_t size, const struct gha_info* info, size_t k)
+{
+	size_t n, j;
+	double a[k], b[k], c[k], s[k];
+
+	for (j = 0; j < k; j++) {
+		a[j] = cos(info[j].frequency);
+		b[j] = sin(info[j].frequency);
+		c[j] = cos(info[j].phase);
+		s[j] = sin(info[j].phase);
+	}
+
+	for (n = 0; n < size; n++) {
+		double sum = 0;
+		for (j = 0; j < k; j++) {
+			const double new_c = a[j] * c[j] - b[j] * s[j];
+			const double new_s = b[j] * c[j] + a[j] * s[j];
+			sum += info[j].magnitude * s[j];
+			c[j] = new_c;
+			s[j] = new_s;
+		}
+		x[n] -= sum;
+	}
+}
+
+/*
+ * Magnitude and phase of each component are fitted once more by least squares
+ * at full rate with the frequency kept, x holds the residual of all k components.
+ * It removes the error of the band filter gain and of leakage between bands.
+ */
+static void subband_refit(FLOAT* x, size_t size, struct gha_info* info, size_t k)
+{
+	size_t n, j;
+
+	for (j = 0; j < k; j++) {
+		const double a = cos(info[j].frequency);
+		const double b = sin(info[j].frequency);
+		double c = 1, s = 0;
+		double ss = 0, sc = 0, cc = 0, xs = 0, xc = 0;
+		double p, q, det, dp, dq;
+
+		for (n = 0; n < size; n++) {
+			const double new_c = a * c - b * s;
+			const double new_s = b * c + a * s;
+			ss += s * s;
+			sc += s * c;
+			cc += c * c;
+			xs += x[n] * s;
+			xc += x[n] * c;
+			c = new_c;
+			s = new_s;
+		}
+
+		det = ss * cc - sc * sc;
+		if (!(det > 0))
+			continue;
+
+		/* magnitude * sin(omega * n + phase) = p * sin(omega * n) + q * cos(omega * n) */
+		dp = (xs * cc - xc * sc) / det;
+		dq = (xc * ss - xs * sc) / det;
+
+		c = 1;
+		s = 0;
+		for (n = 0; n < size; n++) {
+			const double new_c = a * c - b * s;
+			const double new_s = b * c + a * s;
+			x[n] -= dp * s + dq * c;
+			c = new_c;
+			s = new_s;
+		}
+
+		p = info[j].magnitude * cos(info[j].phase) + dp;
+		q = info[j].magnitude * sin(info[j].phase) + dq;
+		info[j].magnitude = sqrt(p * p + q * q);
+		info[j].phase = atan2(q, p);
+		if (info[j].phase < 0)
+			info[j].phase += 2 * M_PI;
+	}
+}
+
+static void subband_estimate(gha_subband_t sb, size_t b)
+{
+	struct subband* band = sb->band + b;
+	const FLOAT peak = gha_estimate_peak(band->x, &band->omega, band->ctx);
+
+	band->peak = peak / fabs(subband_gain(sb, b, band->omega / band->factor));
+	band->blocked = 0;
+}
+
+/*
+ * Newton search stopped at inner edge of the range
+ */
+static int subband_at_edge(const struct subband* band, const struct gha_info* res)
+{
+	return (band->omega_min > 0 && res->frequency <= (FLOAT)band->omega_min * (1 + 1e-6)) ||
+		(band->omega_max < M_PI && res->frequency >= (FLOAT)band->omega_max * (1 - 1e-6));
+}
+
+/*
+ * Map result of band b to full rate
+ */
+static void subband_result(gha_subband_t sb, size_t b, const struct gha_info* res, struct gha_info* info)
+{
+	const struct subband* band = sb->band + b;
+	const double omega = res->frequency / band->factor;
+	const double phase = fmod(res->phase - omega * band->offset, 2 * M_PI);
+
+	info->frequency = omega;
+	info->phase = phase < 0 ? phase + 2 * M_PI : phase;
+	info->magnitude = res->magnitude / subband_gain(sb, b, omega);
+}
+
+/*
+ * Subtract full rate component from band b
+ */
+static void subband_remove(gha_subband_t sb, size_t b, const struct gha_info* info)
+{
+	const struct subband* band = sb->band + b;
+	struct gha_info tmp;
+
+	tmp.frequency = info->frequency * band->factor;
+	tmp.phase = info->phase + info->frequency * band->offset;
+	tmp.magnitude = info->magnitude * subband_gain(sb, b, info->frequency);
+
+	subband_subtract(band->x, band->size, &tmp, 1);
+}
+
+void gha_extract_many_subband(FLOAT* pcm, struct gha_info* info, size_t k, gha_subband_t sb)
+{
+	size_t i = 0;
+	size_t b, j;
+
+	memcpy(sb->band[0].x, pcm, sizeof(FLOAT) * sb->size);
+	for (b = 1; b < sb->bands; b++)
+		decimate(sb->band[b - 1].x, sb->taps, SUBBAND_HALF_TAPS, 2, NULL, sb->band[b].x, sb->band[b].size);
+
+	for (b = 0; b < sb->bands; b++)
+		subband_estimate(sb, b);
+
+	while (i < k) {
+		struct gha_info res;
+		size_t best = sb->bands;
+		FLOAT max = 0;
+
+		/* only the band with the strongest peak is refined */
+		for (b = 0; b < sb->bands; b++) {
+			if (!sb->band[b].blocked && sb->band[b].peak > max) {
+				max = sb->band[b].peak;
+				best = b;
+			}
+		}
+
+		if (best == sb->bands)
+			break;
+
+		gha_analyze_from(sb->band[best].x, sb->band[best].omega, &res, sb->band[best].ctx);
+		if (subband_at_edge(sb->band + best, &res)) {
+			sb->band[best].blocked = 1;
+			continue;
+		}
+
+		subband_result(sb, best, &res, info + i);
+		subband_remove(sb, best, info + i);
+		subband_estimate(sb, best);
+
+		/* the component may leak in to the neighbour bands near the shared edge */
+		for (j = best ? best - 1 : best + 1; j <= best + 1 && j < sb->bands; j += 2) {
+			if (fabs(subband_gain(sb, j, info[i].frequency)) < 1e-3)
+				continue;
+			subband_remove(sb, j, info + i);
+			subband_estimate(sb, j);
+		}
+
+		i++;
+	}
+
+	for (j = i; j < k; j++) {
+		info[j].frequency = 0;
+		info[j].phase = 0;
+		info[j].magnitude = 0;
+	}
+
+	if (i == 0)
+		return;
+
+	subband_subtract(pcm, sb->size, info, i);
+	subband_refit(pcm, sb->size, info, i);
+}
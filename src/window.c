@@ -0,0 +1,247 @@
+#include "window.h"
+
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+static pthread_mutex_t window_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct window* window_cache = NULL;
+
+/*
+ * All windows are zero (or close to it) at -1 and size, so even
+ * windows of the same size are symmetric around (size - 1) / 2
+ */
+static double window_pos(size_t i, size_t size)
+{
+	return (double)(i + 1) / (size + 1);
+}
+
+static double window_bessel_i0(double x)
+{
+	size_t k;
+	double term = 1.0;
+	double sum = 1.0;
+
+	for (k = 1; term > sum * 1e-17; k++) {
+		term *= x * x / (4.0 * k * k);
+		sum += term;
+	}
+
+	return sum;
+}
+
+/*
+ * Number of eigenvalues of symmetric tridiagonal matrix (diagonal d, off diagonal e,
+ * e[0] is unused) less than x, Sturm sequence
+ */
+static size_t window_sturm_count(const double* d, const double* e, size_t size, double x)
+{
+	size_t i;
+	size_t count = 0;
+	double q = 1.0;
+
+	for (i = 0; i < size; i++) {
+		q = d[i] - x - (i ? e[i] * e[i] / q : 0.0);
+		if (q == 0.0)
+			q = 1e-300;
+		if (q < 0)
+			count++;
+	}
+
+	return count;
+}
+
+/*
+ * Zero order discrete prolate spheroidal sequence with half bandwidth nw / size:
+ * eigenvector of the largest eigenvalue of the tridiagonal matrix commuting with
+ * the concentration problem. The eigenvalue is found by bisection and the vector
+ * by inverse iteration, O(size) each step.
+ */
+static int window_dpss(FLOAT* coef, size_t size, double nw)
+{
+	size_t i, loop;
+	const double c = cos(2 * M_PI * nw / size);
+	double lo, hi, max = 0;
+	/* diagonal, off diagonal, vector, elimination work */
+	double* d = malloc(sizeof(double) * size * 4);
+	double* e = d + size;
+	double* v = e + size;
+	double* w = v + size;
+
+	if (!d)
+		return -1;
+
+	for (i = 0; i < size; i++) {
+		const double t = ((double)size - 1 - 2.0 * i) / 2;
+		d[i] = t * t * c;
+		e[i] = i * ((double)size - i) / 2;
+	}
+
+	/* Gershgorin bounds */
+	lo = hi = d[0];
+	for (i = 0; i < size; i++) {
+		const double r = e[i] + (i + 1 < size ? e[i + 1] : 0.0);
+		lo = d[i] - r < lo ? d[i] - r : lo;
+		hi = d[i] + r > hi ? d[i] + r : hi;
+	}
+
+	/* the largest eigenvalue: all but one are below it */
+	while (hi - lo > 1e-14 * (fabs(lo) + fabs(hi))) {
+		const double mid = (lo + hi) / 2;
+		if (mid == lo || mid == hi)
+			break;
+		if (window_sturm_count(d, e, size, mid) < size)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	/* (hi * (1 + eps) - A) is positive definite, so elimination without pivoting is stable */
+	hi += 1e-12 * (fabs(hi) + 1);
+	for (i = 0; i < size; i++)
+		v[i] = 1.0;
+
+	for (loop = 0; loop < 3; loop++) {
+		double norm = 0;
+
+		/* solve (hi - A) x = v, forward elimination */
+		w[0] = hi - d[0];
+		for (i = 1; i < size; i++) {
+			const double m = -e[i] / w[i - 1];
+			w[i] = hi - d[i] + m * e[i];
+			v[i] -= m * v[i - 1];
+		}
+		v[size - 1] /= w[size - 1];
+		for (i = size - 1; i-- > 0;)
+			v[i] = (v[i] + e[i + 1] * v[i + 1]) / w[i];
+
+		for (i = 0; i < size; i++)
+			norm = fabs(v[i]) > norm ? fabs(v[i]) : norm;
+		for (i = 0; i < size; i++)
+			v[i] /= norm;
+	}
+
+	for (i = 0; i < size; i++)
+		max = fabs(v[i]) > max ? fabs(v[i]) : max;
+	for (i = 0; i < size; i++)
+		coef[i] = fabs(v[i]) / max;
+
+	free(d);
+	return 0;
+}
+
+static int window_compute(struct window* window)
+{
+	size_t i;
+	const size_t size = window->size;
+	FLOAT* coef = window->coef;
+
+	switch (window->type) {
+	case GHA_WINDOW_SINE:
+		for (i = 0; i < size; i++)
+			coef[i] = sin(M_PI * window_pos(i, size));
+		break;
+	case GHA_WINDOW_HANN:
+		for (i = 0; i < size; i++)
+			coef[i] = 0.5 - 0.5 * cos(2 * M_PI * window_pos(i, size));
+		break;
+	case GHA_WINDOW_BLACKMAN_HARRIS:
+		for (i = 0; i < size; i++) {
+			const double x = 2 * M_PI * window_pos(i, size);
+			coef[i] = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) - 0.01168 * cos(3 * x);
+		}
+		break;
+	case GHA_WINDOW_KAISER:
+		for (i = 0; i < size; i++) {
+			const double t = 2 * window_pos(i, size) - 1;
+			coef[i] = window_bessel_i0(window->param * sqrt(1 - t * t)) / window_bessel_i0(window->param);
+		}
+		break;
+	case GHA_WINDOW_DPSS:
+		if (window_dpss(coef, size, window->param))
+			return -1;
+		break;
+	default:
+		return -1;
+	}
+
+	window->sum = 0;
+	for (i = 0; i < size; i++)
+		window->sum += coef[i];
+
+	return 0;
+}
+
+static int window_param_valid(enum gha_window type, double param, size_t size)
+{
+	switch (type) {
+	case GHA_WINDOW_KAISER:
+		return param >= 0 && param <= 700;
+	case GHA_WINDOW_DPSS:
+		return param > 0 && param < size / 2.0;
+	default:
+		return 1;
+	}
+}
+
+const struct window* window_acquire(enum gha_window type, double param, size_t size)
+{
+	struct window* window;
+
+	if (size == 0 || !window_param_valid(type, param, size))
+		return NULL;
+
+	/* param is a part of the key only for parametric windows */
+	if (type != GHA_WINDOW_KAISER && type != GHA_WINDOW_DPSS)
+		param = 0;
+
+	pthread_mutex_lock(&window_lock);
+
+	for (window = window_cache; window; window = window->next) {
+		if (window->type == type && window->param == param && window->size == size) {
+			window->refs++;
+			goto exit_unlock;
+		}
+	}
+
+	window = malloc(sizeof(struct window) + sizeof(FLOAT) * size);
+	if (!window)
+		goto exit_unlock;
+
+	window->size = size;
+	window->coef = (FLOAT*)(window + 1);
+	window->type = type;
+	window->param = param;
+	window->refs = 1;
+
+	if (window_compute(window)) {
+		free(window);
+		window = NULL;
+		goto exit_unlock;
+	}
+
+	window->next = window_cache;
+	window_cache = window;
+exit_unlock:
+	pthread_mutex_unlock(&window_lock);
+	return window;
+}
+
+void window_release(const struct window* window)
+{
+	struct window** p;
+
+	pthread_mutex_lock(&window_lock);
+
+	for (p = &window_cache; *p; p = &(*p)->next) {
+		if (*p == window) {
+			if (--(*p)->refs == 0) {
+				*p = window->next;
+				free((struct window*)window);
+			}
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&window_lock);
+}
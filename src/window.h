@@ -0,0 +1,31 @@
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <include/libgha.h>
+
+/*
+ * Analysis window tables. A table is computed once per (type, param, size)
+ * and shared by all users until the last one releases it.
+ */
+
+struct window {
+	size_t size;
+	FLOAT* coef;
+	/* sum of the coefficients */
+	double sum;
+
+	/* cache key and number of users */
+	enum gha_window type;
+	double param;
+	size_t refs;
+	struct window* next;
+};
+
+/*
+ * Returns shared table or null in case of fail (unknown type, bad param or no memory)
+ */
+const struct window* window_acquire(enum gha_window type, double param, size_t size);
+
+void window_release(const struct window* window);
+
+#endif
@@ -10,6 +10,7 @@ void usage(const char* selfname) {
 	fprintf(stderr, "EXPECTED_MAGNITUDE_(LOW|HIGH) - expected magnitude (0 - 1)\n");
 }
 
+/* the last two residual levels: after the last extraction and after adjustment */
 static void calc_resuidal(FLOAT* resuidal, size_t size, void* user_ctx)
 {
 	int i;
@@ -18,7 +19,8 @@ static void calc_resuidal(FLOAT* resuidal, size_t size, void* user_ctx)
 	for (i = 0; i < size; i++) {
 		s += resuidal[i] * resuidal[i];
 	}
-	*result = sqrt(s / size);
+	result[0] = result[1];
+	result[1] = sqrt(s / size);
 }
 
 int main(int argc, char** argv) {
@@ -32,8 +34,7 @@ int main(int argc, char** argv) {
 	gha_ctx_t ctx;
 
 	FLOAT* buf = malloc(len * sizeof(FLOAT));
-	FLOAT* buf2 = malloc(len * sizeof(FLOAT));
-	if (!buf || !buf2)
+	if (!buf)
 		abort();
 
 	if (load_file(argv[1], len, atoi(argv[2]), 8, buf)) {
@@ -42,22 +43,23 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 
-	//Make copy of data to adjust extracted params
-	memcpy(buf2, buf, sizeof(FLOAT) * len);
 	ctx = gha_create_ctx(len);
 
-	FLOAT resuidal;
-	gha_set_user_resuidal_cb(&calc_resuidal, &resuidal, ctx);
+	FLOAT resuidal[2] = {0, 0};
 	if (!ctx) {
 		fprintf(stderr, "Unable to create gha ctx\n");
 		free(buf);
 		return 1;
 	}
+	gha_set_user_resuidal_cb(&calc_resuidal, resuidal, ctx);
 
 	struct gha_info res[2];
-	gha_extract_many_simple(buf, &res[0], 2, ctx);
+	gha_extract_many_adjusted(buf, NULL, &res[0], 2, ctx);
 
-	FLOAT resuidal_1 = resuidal;
+	if (resuidal[1] > resuidal[0]) {
+		fprintf(stderr, "gha_extract_many_adjusted wrong result\n");
+		return 1;
+	}
 
 	if (res[0].frequency > res[1].frequency) {
 		struct gha_info tmp;
@@ -66,14 +68,6 @@ int main(int argc, char** argv) {
 		memcpy(&res[1], &tmp, sizeof(struct gha_info));
 	}
 
-	gha_adjust_info(buf2, res, 2, ctx);
-
-	if (resuidal > resuidal_1) {
-		fprintf(stderr, "gha_adjust_info wrong result\n");
-		return 1;
-	}
-
-
 	gha_free_ctx(ctx);
 	free(buf);
 
@@ -0,0 +1,185 @@
+#include <include/libgha_dtmf.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#define FRAME 160
+/* one digit per cycle: 80 ms tone and 120 ms of noise */
+#define CYCLE 1600
+#define TONE 640
+#define VARIANTS 64
+#define CYCLES 16
+#define STREAM (CYCLE * CYCLES)
+
+static const double freq[8] = {697, 770, 852, 941, 1209, 1336, 1477, 1633};
+static const char digits[] = "123A456B789C*0#D";
+
+static uint8_t streams[VARIANTS][STREAM];
+
+void usage(const char* selfname) {
+	fprintf(stderr, "GHA dtmf detector benchmark, usage: %s <CHANNELS> <SECONDS> <THREADS>\n", selfname);
+	fprintf(stderr, "CHANNELS - number of 8 kHz mu-law channels\n");
+	fprintf(stderr, "SECONDS - length of audio to process per channel\n");
+	fprintf(stderr, "THREADS - number of threads, each one runs own detector\n");
+	fprintf(stderr, "Returns not zero if detected digits do not match generated ones\n");
+}
+
+static uint8_t ulaw_encode(FLOAT x)
+{
+	const int bias = 0x84;
+	int sign, exp, mant;
+	int v = lrint(x * 32767);
+
+	sign = v < 0 ? 0x80 : 0;
+	if (v < 0)
+		v = -v;
+	if (v > 32635)
+		v = 32635;
+	v += bias;
+
+	for (exp = 7; exp > 0 && !(v & (0x4000 >> (7 - exp))); exp--)
+		;
+	mant = (v >> (exp + 3)) & 0x0f;
+
+	return ~(sign | (exp << 4) | mant);
+}
+
+static char expected_digit(size_t variant, size_t cycle)
+{
+	return digits[(variant + cycle) % 16];
+}
+
+/*
+ * Variant v: tone of cycle k is digit (v + k) % 16 starting at v * 7 samples
+ * offset, tone levels and twist depend on v
+ */
+static void generate(void)
+{
+	size_t v, k, i;
+
+	srand(1);
+	for (v = 0; v < VARIANTS; v++) {
+		const double low = pow(10, (-10.0 - v % 5 * 2) / 20);
+		const double high = low * pow(10, ((double)(v % 3) - 1) * 2 / 20);
+		const size_t offset = v * 7 % (CYCLE - TONE - FRAME);
+
+		for (k = 0; k < CYCLES; k++) {
+			const int d = (v + k) % 16;
+			const double wl = 2 * M_PI * freq[d / 4] / 8000;
+			const double wh = 2 * M_PI * freq[4 + d % 4] / 8000;
+			for (i = 0; i < CYCLE; i++) {
+				FLOAT x = 0.003 * ((double)rand() / RAND_MAX - 0.5);
+				if (i >= offset && i < offset + TONE)
+					x += low * sin(wl * i + v) + high * sin(wh * i + k);
+				streams[v][k * CYCLE + i] = ulaw_encode(x);
+			}
+		}
+	}
+}
+
+struct worker {
+	pthread_t thread;
+	size_t first;
+	size_t channels;
+	size_t frames;
+	size_t events;
+	size_t errors;
+};
+
+static void* run(void* arg)
+{
+	struct worker* w = arg;
+	size_t f, c, e, n;
+	const uint8_t** ptrs = malloc(sizeof(uint8_t*) * w->channels);
+	struct gha_dtmf_event* events = malloc(sizeof(struct gha_dtmf_event) * w->channels);
+	gha_dtmf_t dtmf = gha_dtmf_create(w->channels, FRAME);
+
+	if (!ptrs || !events || !dtmf) {
+		w->errors = 1;
+		return NULL;
+	}
+
+	for (f = 0; f < w->frames; f++) {
+		for (c = 0; c < w->channels; c++)
+			ptrs[c] = streams[(w->first + c) % VARIANTS] + f * FRAME % STREAM;
+
+		n = gha_dtmf_process_ulaw(dtmf, 0, w->channels, ptrs, events);
+
+		for (e = 0; e < n; e++) {
+			const size_t ch = w->first + events[e].channel;
+			const size_t cycle = events[e].frame * FRAME / CYCLE % CYCLES;
+			if (events[e].digit != expected_digit(ch % VARIANTS, cycle))
+				w->errors++;
+		}
+		w->events += n;
+	}
+
+	gha_dtmf_free(dtmf);
+	free(events);
+	free(ptrs);
+
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	size_t i, channels, frames, expected, events = 0, errors = 0;
+	int threads;
+	struct worker* workers;
+	struct timespec t0, t1;
+	clock_t c0;
+	double cpu, wall, audio;
+
+	if (argc != 4) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	channels = atoll(argv[1]);
+	/* whole number of cycles */
+	frames = ceil(atof(argv[2]) * 8000 / CYCLE) * (CYCLE / FRAME);
+	threads = atoi(argv[3]);
+	if (channels == 0 || frames == 0 || threads <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	generate();
+
+	workers = calloc(threads, sizeof(struct worker));
+	for (i = 0; i < threads; i++) {
+		workers[i].first = channels * i / threads;
+		workers[i].channels = channels * (i + 1) / threads - workers[i].first;
+		workers[i].frames = frames;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	c0 = clock();
+
+	for (i = 0; i < threads; i++)
+		pthread_create(&workers[i].thread, NULL, run, workers + i);
+	for (i = 0; i < threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		events += workers[i].events;
+		errors += workers[i].errors;
+	}
+
+	cpu = (double)(clock() - c0) / CLOCKS_PER_SEC;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	wall = t1.tv_sec - t0.tv_sec + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+	audio = (double)frames * FRAME / 8000;
+
+	/* each cycle gives one digit */
+	expected = channels * (frames * FRAME / CYCLE);
+
+	printf("channels: %zu, threads: %d, audio: %.2f s, cpu: %.3f s, wall: %.3f s\n", channels, threads, audio, cpu, wall);
+	printf("channels per core: %.0f, digits: %zu (expected %zu), wrong: %zu\n", channels * audio / cpu, events, expected, errors);
+
+	free(workers);
+
+	return errors || events != expected;
+}
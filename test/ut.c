@@ -1,6 +1,13 @@
 #include <3rd/fctx/fct.h>
 
 #include <sle.h>
+#include <fft.h>
+#include <pcm.h>
+#include <batch.h>
+#include <kernels.h>
+#include <include/libgha_dtmf.h>
+
+#include <tools/kiss_fftr.h>
 
 static double eq_matrix_1[3][4] =
 	{{ 2,	 1,	-1,	 8},
@@ -14,6 +21,1533 @@ static double eq_matrix_2[2][3] =
 	{4,	2,	2}};
 
 
+/*
+ * Max difference between fft_real and reference complex kiss_fft output
+ * normalized by max reference bin magnitude
+ */
+static double fft_real_error(size_t n)
+{
+	size_t i;
+	double err = 0.0;
+	double norm = 0.0;
+	FLOAT* in = malloc(sizeof(FLOAT) * n);
+	kiss_fft_cpx* out = malloc(sizeof(kiss_fft_cpx) * (n / 2 + 1));
+	kiss_fft_cpx* ref_in = malloc(sizeof(kiss_fft_cpx) * n);
+	kiss_fft_cpx* ref = malloc(sizeof(kiss_fft_cpx) * n);
+	struct fft* fft = fft_alloc(n);
+	kiss_fft_cfg cfg = kiss_fft_alloc(n, 0, NULL, NULL);
+
+	srand(n);
+	for (i = 0; i < n; i++) {
+		in[i] = (double)rand() / RAND_MAX - 0.5;
+		ref_in[i].r = in[i];
+		ref_in[i].i = 0;
+	}
+
+	fft_real(fft, in, out);
+	kiss_fft(cfg, ref_in, ref);
+
+	for (i = 0; i < n / 2 + 1; i++) {
+		norm = fmax(norm, hypot(ref[i].r, ref[i].i));
+		err = fmax(err, hypot(ref[i].r - out[i].r, ref[i].i - out[i].i));
+	}
+
+	kiss_fft_free(cfg);
+	fft_free(fft);
+	free(ref);
+	free(ref_in);
+	free(out);
+	free(in);
+
+	return err / norm;
+}
+
+/*
+ * Max difference between fft_cpx and reference kiss_fft output
+ * normalized by max reference bin magnitude
+ */
+static double fft_cpx_error(size_t n)
+{
+	size_t i;
+	double err = 0.0;
+	double norm = 0.0;
+	kiss_fft_cpx* in = malloc(sizeof(kiss_fft_cpx) * n);
+	kiss_fft_cpx* out = malloc(sizeof(kiss_fft_cpx) * n);
+	kiss_fft_cpx* ref = malloc(sizeof(kiss_fft_cpx) * n);
+	struct fft* fft = fft_alloc_cpx(n);
+	kiss_fft_cfg cfg = kiss_fft_alloc(n, 0, NULL, NULL);
+
+	srand(n);
+	for (i = 0; i < n; i++) {
+		in[i].r = (double)rand() / RAND_MAX - 0.5;
+		in[i].i = (double)rand() / RAND_MAX - 0.5;
+	}
+
+	fft_cpx(fft, in, out);
+	kiss_fft(cfg, in, ref);
+
+	for (i = 0; i < n; i++) {
+		norm = fmax(norm, hypot(ref[i].r, ref[i].i));
+		err = fmax(err, hypot(ref[i].r - out[i].r, ref[i].i - out[i].i));
+	}
+
+	kiss_fft_free(cfg);
+	fft_free(fft);
+	free(ref);
+	free(out);
+	free(in);
+
+	return err / norm;
+}
+
+/*
+ * Sine of synthetic frames: magnitude * sin(frequency * i + phase)
+ */
+struct tone {
+	double frequency;
+	double phase;
+	double magnitude;
+};
+
+/*
+ * Add scale times sum of k tones to n samples pcm[i * stride]
+ */
+static void tones_add(FLOAT* pcm, size_t n, size_t stride, const struct tone* tones, size_t k, double scale)
+{
+	size_t i, j;
+
+	for (i = 0; i < n; i++) {
+		double x = 0;
+		for (j = 0; j < k; j++)
+			x += tones[j].magnitude * sin(tones[j].frequency * i + tones[j].phase);
+		pcm[i * stride] += scale * x;
+	}
+}
+
+/*
+ * Tones of k found components
+ */
+static void tones_of_info(const struct gha_info* info, size_t k, struct tone* tones)
+{
+	size_t j;
+
+	for (j = 0; j < k; j++) {
+		tones[j].frequency = info[j].frequency;
+		tones[j].phase = info[j].phase;
+		tones[j].magnitude = info[j].magnitude;
+	}
+}
+
+/*
+ * Returns 0 if info matches the tone: frequency, phase (modulo 2 pi) and magnitude
+ * differences are within given tolerances, negative tolerance skips the field
+ */
+static int tone_check(const struct gha_info* info, const struct tone* tone, double df, double dp, double dm)
+{
+	if (df >= 0 && fabs(info->frequency - tone->frequency) > df)
+		return -1;
+	if (dp >= 0 && fabs(remainder(info->phase - tone->phase, 2 * M_PI)) > dp)
+		return -1;
+	if (dm >= 0 && fabs(info->magnitude - tone->magnitude) > dm)
+		return -1;
+	return 0;
+}
+
+/*
+ * Returns 0 if info matches reference component within the tolerances
+ */
+static int info_check(const struct gha_info* info, const struct gha_info* ref, double df, double dp, double dm)
+{
+	struct tone tone;
+
+	tones_of_info(ref, 1, &tone);
+
+	return tone_check(info, &tone, df, dp, dm);
+}
+
+/*
+ * Sum of squared samples
+ */
+static double signal_energy(const FLOAT* x, size_t n)
+{
+	size_t i;
+	double energy = 0;
+
+	for (i = 0; i < n; i++)
+		energy += x[i] * x[i];
+
+	return energy;
+}
+
+/*
+ * Analyze pure sine with given parameters, returns 0 if result matches
+ */
+static int gha_check_sine(size_t n, size_t oversample, FLOAT freq, FLOAT phase, FLOAT magn)
+{
+	int rv = 0;
+	struct gha_info res;
+	const struct tone tone = {freq, phase, magn};
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	if (!ctx || gha_set_fft_padding(oversample, ctx))
+		rv = -1;
+
+	tones_add(pcm, n, 1, &tone, 1, 1);
+
+	if (rv == 0) {
+		gha_analyze_one(pcm, &res, ctx);
+		rv = tone_check(&res, &tone, 0.0001, 0.001, 0.001);
+	}
+
+	if (ctx)
+		gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Frames too short for a frequency extremum give finite result,
+ * returns 0 if analysis and extraction of such frame are finite
+ */
+static int gha_check_tiny(size_t n)
+{
+	size_t i;
+	int rv = 0;
+	struct gha_info res;
+	FLOAT pcm[4] = {0.3, -0.2, 0.5, 0.1};
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	if (!ctx)
+		return -1;
+
+	gha_analyze_one(pcm, &res, ctx);
+	if (!isfinite(res.frequency) || !isfinite(res.phase) || !isfinite(res.magnitude))
+		rv = -1;
+
+	gha_extract_one(pcm, &res, ctx);
+	for (i = 0; i < n; i++) {
+		if (!isfinite(pcm[i]))
+			rv = -1;
+	}
+
+	gha_free_ctx(ctx);
+
+	return rv;
+}
+
+/*
+ * Compare gha_analyze_batch with gha_analyze_one for count frames
+ * of different sines, returns 0 if results match
+ */
+static int gha_check_batch(size_t n, size_t oversample, size_t count)
+{
+	size_t i;
+	int rv = 0;
+	struct gha_info* res = malloc(sizeof(struct gha_info) * count);
+	FLOAT** pcm = malloc(sizeof(FLOAT*) * count);
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	gha_set_fft_padding(oversample, ctx);
+
+	for (i = 0; i < count; i++) {
+		const struct tone tone = {0.2 + 0.31 * i, 0.1 * i, 0.1 + 0.05 * i};
+		pcm[i] = calloc(n, sizeof(FLOAT));
+		tones_add(pcm[i], n, 1, &tone, 1, 1);
+	}
+
+	gha_analyze_batch((const FLOAT* const*)pcm, res, count, ctx);
+
+	for (i = 0; i < count; i++) {
+		struct gha_info ref;
+		gha_analyze_one(pcm[i], &ref, ctx);
+		if (info_check(res + i, &ref, 1e-5, 1e-4, 1e-5))
+			rv = -1;
+		free(pcm[i]);
+	}
+
+	gha_free_ctx(ctx);
+	free(pcm);
+	free(res);
+
+	return rv;
+}
+
+/*
+ * Compare gha_analyze_batch with gha_analyze_one under a context setting the
+ * batch path does not cover: 0 - zoom, 1 - spectral refinement, 2 - decimated
+ * band, returns 0 if results are identical
+ */
+static int gha_check_batch_setting(size_t n, size_t count, int setting)
+{
+	size_t i;
+	int rv = 0;
+	struct gha_info* res = malloc(sizeof(struct gha_info) * count);
+	FLOAT** pcm = malloc(sizeof(FLOAT*) * count);
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	if (setting == 0)
+		gha_set_zoom(4, ctx);
+	else if (setting == 1)
+		gha_set_refine(GHA_REFINE_SPECTRAL, ctx);
+	else
+		gha_set_band(0.05, 0.6, ctx);
+
+	for (i = 0; i < count; i++) {
+		const struct tone tone = {0.1 + 0.05 * i, 0.1 * i, 0.1 + 0.05 * i};
+		pcm[i] = calloc(n, sizeof(FLOAT));
+		tones_add(pcm[i], n, 1, &tone, 1, 1);
+	}
+
+	gha_analyze_batch((const FLOAT* const*)pcm, res, count, ctx);
+
+	for (i = 0; i < count; i++) {
+		struct gha_info ref;
+		gha_analyze_one(pcm[i], &ref, ctx);
+		if (info_check(res + i, &ref, 0, 0, 0))
+			rv = -1;
+		free(pcm[i]);
+	}
+
+	gha_free_ctx(ctx);
+	free(pcm);
+	free(res);
+
+	return rv;
+}
+
+/*
+ * Compare gha_analyze_interleaved with gha_analyze_one of deinterleaved
+ * channels, returns 0 if results match
+ */
+static int gha_check_interleaved(size_t n, size_t channels)
+{
+	size_t i, c;
+	int rv = 0;
+	struct gha_info* res = malloc(sizeof(struct gha_info) * channels);
+	FLOAT* pcm = calloc(n * channels, sizeof(FLOAT));
+	FLOAT* frame = malloc(sizeof(FLOAT) * n);
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	for (c = 0; c < channels; c++) {
+		const struct tone tone = {0.2 + 0.17 * c, 0.1 * c, 0.1 + 0.05 * c};
+		tones_add(pcm + c, n, channels, &tone, 1, 1);
+	}
+
+	gha_analyze_interleaved(pcm, channels, res, ctx);
+
+	for (c = 0; c < channels; c++) {
+		struct gha_info ref;
+		for (i = 0; i < n; i++)
+			frame[i] = pcm[i * channels + c];
+		gha_analyze_one(frame, &ref, ctx);
+		if (info_check(res + c, &ref, 1e-5, 1e-4, 1e-5))
+			rv = -1;
+	}
+
+	gha_free_ctx(ctx);
+	free(frame);
+	free(pcm);
+	free(res);
+
+	return rv;
+}
+
+/*
+ * Extract two components common for channels with joint analysis,
+ * returns 0 if frequencies, phases and magnitudes match
+ */
+static int gha_check_joint(size_t n, size_t channels)
+{
+	size_t c;
+	int rv = 0;
+	struct gha_info* res = malloc(sizeof(struct gha_info) * channels * 2);
+	FLOAT** pcm = malloc(sizeof(FLOAT*) * channels);
+	struct tone* tones = malloc(sizeof(struct tone) * channels * 2);
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	/* the same frequencies, own phases and magnitudes in each channel */
+	for (c = 0; c < channels; c++) {
+		const struct tone tone[2] = {{0.3, 0.2 * c, 0.5 + 0.1 * c}, {0.7, 1.0 + 0.3 * c, 0.2}};
+		tones[c] = tone[0];
+		tones[channels + c] = tone[1];
+		pcm[c] = calloc(n, sizeof(FLOAT));
+		tones_add(pcm[c], n, 1, tone, 2, 1);
+	}
+
+	gha_extract_many_joint(pcm, channels, res, 2, ctx);
+
+	for (c = 0; c < channels * 2; c++) {
+		if (tone_check(res + c, tones + c, 0.001, 0.01, 0.01))
+			rv = -1;
+	}
+
+	/* silent channel has zero magnitude */
+	memset(pcm[0], 0, sizeof(FLOAT) * n);
+	gha_analyze_joint((const FLOAT* const*)pcm, channels, res, ctx);
+	if (res[0].magnitude != 0 || res[0].frequency != res[0].frequency)
+		rv = -1;
+
+	for (c = 0; c < channels; c++)
+		free(pcm[c]);
+
+	gha_free_ctx(ctx);
+	free(tones);
+	free(pcm);
+	free(res);
+
+	return rv;
+}
+
+/*
+ * Joint analysis of 0 channels does nothing, returns 0 if info is untouched
+ */
+static int gha_check_joint_empty(size_t n)
+{
+	struct gha_info res = {1, 2, 3};
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	gha_analyze_joint(NULL, 0, &res, ctx);
+	gha_extract_one_joint(NULL, 0, &res, ctx);
+	gha_extract_many_joint(NULL, 0, &res, 1, ctx);
+
+	gha_free_ctx(ctx);
+
+	return res.frequency == 1 && res.phase == 2 && res.magnitude == 3 ? 0 : -1;
+}
+
+/*
+ * Extract two complex tones from I/Q signal, returns 0 if result matches
+ */
+static int gha_check_complex(size_t n, size_t oversample, FLOAT freq1, FLOAT freq2)
+{
+	int rv = 0;
+	struct gha_info res[2];
+	const struct tone tones[2] = {{freq1, 0.3, 0.5}, {freq2, -2.0, 0.1}};
+	/* cos of I component is sin shifted by pi / 2 */
+	const struct tone shifted[2] = {{freq1, 0.3 + M_PI / 2, 0.5}, {freq2, -2.0 + M_PI / 2, 0.1}};
+	FLOAT* iq = calloc(n * 2, sizeof(FLOAT));
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	gha_set_fft_padding(oversample, ctx);
+
+	tones_add(iq, n, 2, shifted, 2, 1);
+	tones_add(iq + 1, n, 2, tones, 2, 1);
+
+	if (gha_extract_one_complex(iq, res, ctx) || gha_extract_one_complex(iq, res + 1, ctx))
+		rv = -1;
+
+	if (tone_check(res, tones, 1e-4, 1e-3, 1e-3) || tone_check(res + 1, tones + 1, 1e-4, 1e-2, 1e-3))
+		rv = -1;
+
+	gha_free_ctx(ctx);
+	free(iq);
+
+	return rv;
+}
+
+/*
+ * Refine candidates of two tones signal, returns 0 if result matches
+ */
+static int gha_check_candidates(size_t n)
+{
+	size_t i;
+	int rv = 0;
+	/* up to 1.5 bins off */
+	const FLOAT d = 2 * M_PI / n;
+	const FLOAT omega[5] = {0.3 + d, 1.2, 0.3 - 1.5 * d, 1.2 - 0.7 * d, 0.3 + 0.5 * d};
+	const struct tone tones[2] = {{0.3, 0.4, 0.6}, {1.2, 1.5, 0.3}};
+	struct gha_info res[5];
+	FLOAT fit[5];
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	tones_add(pcm, n, 1, tones, 2, 1);
+
+	gha_analyze_candidates(pcm, omega, 5, res, fit, ctx);
+
+	for (i = 0; i < 5; i++) {
+		const int low = i % 2 == 0;
+		if (tone_check(res + i, tones + !low, 1e-3, -1, 1e-2) || fabs(fit[i] - (low ? 0.8 : 0.2)) > 1e-2)
+			rv = -1;
+	}
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Candidates of the same two tones signal under band, field mask and
+ * energy gate settings, returns 0 if results follow the settings
+ */
+static int gha_check_candidates_settings(size_t n)
+{
+	size_t i;
+	int rv = 0;
+	const FLOAT omega[2] = {0.3, 1.2};
+	const struct tone tones[2] = {{0.3, 0.4, 0.6}, {1.2, 1.5, 0.3}};
+	struct gha_info res[2];
+	FLOAT fit[2];
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	tones_add(pcm, n, 1, tones, 2, 1);
+
+	/* the high candidate is kept inside the band */
+	gha_set_band(0.1, 0.6, ctx);
+	gha_analyze_candidates(pcm, omega, 2, res, NULL, ctx);
+	if (tone_check(res, tones, 1e-3, -1, 1e-2) || res[1].frequency < (FLOAT)0.1 || res[1].frequency > (FLOAT)0.6)
+		rv = -1;
+	gha_set_band(0, M_PI, ctx);
+
+	/* fit is computed without magnitude and phase */
+	gha_set_fields(GHA_FIELD_FREQUENCY, ctx);
+	gha_analyze_candidates(pcm, omega, 2, res, fit, ctx);
+	for (i = 0; i < 2; i++) {
+		if (fabs(res[i].frequency - tones[i].frequency) > 1e-3 || res[i].phase != 0 || res[i].magnitude != 0)
+			rv = -1;
+	}
+	if (fabs(fit[0] - 0.8) > 1e-2 || fabs(fit[1] - 0.2) > 1e-2)
+		rv = -1;
+	gha_set_fields(GHA_FIELDS_ALL, ctx);
+
+	/* the frame is below the gate */
+	gha_set_energy_gate(1.0, ctx);
+	gha_analyze_candidates(pcm, omega, 2, res, fit, ctx);
+	for (i = 0; i < 2; i++) {
+		if (res[i].frequency != 0 || res[i].phase != 0 || res[i].magnitude != 0 || fit[i] != 0)
+			rv = -1;
+	}
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Weak sine at omega inside [omega_min, omega_max] and 4 times stronger one
+ * at omega_out outside of it, checks single frame and batch analysis of the band
+ */
+static int gha_check_band(size_t n, FLOAT omega, FLOAT omega_out, FLOAT omega_min, FLOAT omega_max)
+{
+	size_t i;
+	int rv = 0;
+	struct gha_info res[3];
+	const struct tone tones[2] = {{omega, 0.7, 0.2}, {omega_out, 0.1, 0.8}};
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	const FLOAT* frames[2] = {pcm, pcm};
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	tones_add(pcm, n, 1, tones, 2, 1);
+
+	if (gha_set_band(omega_min, omega_max, ctx) || gha_set_band(1.0, 0.5, ctx) == 0)
+		rv = -1;
+
+	gha_analyze_one(pcm, res, ctx);
+	gha_analyze_batch(frames, res + 1, 2, ctx);
+
+	for (i = 0; i < 3; i++) {
+		if (tone_check(res + i, tones, 1e-4, 1e-2, 1e-2))
+			rv = -1;
+	}
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Zoom stage gives the same result as plain fft bin search, also with
+ * a weaker component near the strongest one
+ */
+static int gha_check_zoom(size_t n, size_t zoom, FLOAT omega)
+{
+	int rv = 0;
+	struct gha_info res[2];
+	const struct tone tones[2] = {{omega, 0.3, 0.5}, {omega + 20 * M_PI / n, 0, 0.1}};
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	tones_add(pcm, n, 1, tones, 2, 1);
+
+	gha_analyze_one(pcm, res, ctx);
+	if (gha_set_zoom(zoom, ctx))
+		rv = -1;
+	gha_analyze_one(pcm, res + 1, ctx);
+
+	if (info_check(res + 1, res, 1e-6, 1e-2, 1e-3) || tone_check(res + 1, tones, 1e-4, -1, -1))
+		rv = -1;
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Spectral refinement gives about the same result as time domain one
+ */
+static int gha_check_refine(size_t n, enum gha_refine refine, FLOAT omega, FLOAT tolerance)
+{
+	int rv = 0;
+	struct gha_info res[2];
+	const struct tone tones[3] = {{omega, 0.3, 0.5}, {omega + 14 * M_PI / n, 0, 0.1}, {0.3 * omega, 0, 0.05}};
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	tones_add(pcm, n, 1, tones, 3, 1);
+
+	gha_analyze_one(pcm, res, ctx);
+	gha_set_refine(refine, ctx);
+	gha_analyze_one(pcm, res + 1, ctx);
+
+	if (info_check(res + 1, res, tolerance * 2 * M_PI / n, 1e-2, 1e-3))
+		rv = -1;
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Two components are found with any window, also with decimated estimation
+ */
+static int gha_check_window(size_t n, enum gha_window type, FLOAT param)
+{
+	int rv = 0;
+	struct gha_info res[3];
+	const struct tone tones[2] = {{0.05, 0.5, 0.7}, {1.1, 1.5, 0.3}};
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	tones_add(pcm, n, 1, tones, 2, 1);
+
+	if (gha_set_window(type, param, ctx))
+		rv = -1;
+
+	gha_extract_many_simple(pcm, res, 2, ctx);
+
+	/* low band, the window is kept */
+	memset(pcm, 0, sizeof(FLOAT) * n);
+	tones_add(pcm, n, 1, tones, 1, 1);
+	if (gha_set_band(0.01, 0.2, ctx))
+		rv = -1;
+	gha_analyze_one(pcm, res + 2, ctx);
+
+	if (tone_check(res, tones, 1e-4, 1e-2, 1e-2) || tone_check(res + 1, tones + 1, 1e-4, 1e-2, 1e-2) ||
+		tone_check(res + 2, tones, 1e-4, -1, 1e-2))
+		rv = -1;
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Peak search kernel against plain loop over random spectra with plateaus,
+ * returns number of mismatches
+ */
+static int peaks_check_kernel(size_t (*find)(const kiss_fft_cpx*, size_t, size_t, FLOAT, const unsigned char*, size_t, FLOAT*, size_t*, FLOAT*))
+{
+	size_t t, i, j, n, m;
+	int rv = 0;
+	kiss_fft_cpx bins[300];
+	unsigned char mask[300];
+	FLOAT power[300], value[8], ref_value[8];
+	size_t index[8], ref_index[8];
+
+	srand(7);
+	for (t = 0; t < 200; t++) {
+		const size_t first = rand() % 40;
+		const size_t last = first + rand() % 250;
+		const size_t k = 1 + rand() % 8;
+		const FLOAT threshold = t % 3 ? 0.5 : -1;
+
+		for (i = 0; i <= last; i++) {
+			bins[i].r = rand() % 4;
+			bins[i].i = rand() % 2;
+			mask[i] = rand() % 5 == 0;
+		}
+
+		n = find(bins, first, last, threshold, t % 2 ? mask : NULL, k, power, index, value);
+
+		m = 0;
+		for (i = first; i <= last; i++) {
+			const FLOAT p = bins[i].r * bins[i].r + bins[i].i * bins[i].i;
+			const FLOAT prev = i > first ? bins[i - 1].r * bins[i - 1].r + bins[i - 1].i * bins[i - 1].i : -1;
+			const FLOAT next = i < last ? bins[i + 1].r * bins[i + 1].r + bins[i + 1].i * bins[i + 1].i : -1;
+			if (p <= threshold || p <= prev || p < next || (t % 2 && mask[i]))
+				continue;
+			for (j = m < k ? m : k; j > 0 && ref_value[j - 1] < p; j--) {
+				if (j < k) {
+					ref_index[j] = ref_index[j - 1];
+					ref_value[j] = ref_value[j - 1];
+				}
+			}
+			if (j < k) {
+				ref_index[j] = i;
+				ref_value[j] = p;
+				m += m < k;
+			}
+		}
+
+		if (n != m)
+			rv++;
+		for (i = 0; i < n && i < m; i++)
+			rv += index[i] != ref_index[i] || value[i] != ref_value[i];
+	}
+
+	return rv;
+}
+
+/*
+ * Frame parallel Newton search and magnitude of count frames of n samples,
+ * lane l holds its own tone and the last lane is silent. Each lane is checked
+ * against the tone and against the per frame kernels on the same frame.
+ * Returns number of mismatches.
+ */
+static int batch_check_newton(const struct kernels* kern, size_t n, size_t count)
+{
+	size_t i, l;
+	int rv = 0;
+	struct gha_info ref;
+	struct tone tones[16];
+	const size_t lanes = kern->batch.lanes();
+	double omega[16] = {0}, phase[16] = {0}, magnitude[16] = {0};
+	FLOAT* raw = calloc(n * lanes, sizeof(FLOAT));
+	FLOAT* x = calloc(n * lanes, sizeof(FLOAT));
+	FLOAT* frame = malloc(sizeof(FLOAT) * n);
+	FLOAT* sine = malloc(sizeof(FLOAT) * n);
+	FLOAT* window = malloc(sizeof(FLOAT) * n);
+
+	for (i = 0; i < n; i++)
+		window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / n);
+
+	for (l = 0; l + 1 < count; l++) {
+		tones[l].frequency = 0.5 + 0.3 * l;
+		tones[l].phase = 0.3 * l;
+		tones[l].magnitude = 0.5 + 0.1 * l;
+		tones_add(raw + l, n, lanes, tones + l, 1, 1);
+		for (i = 0; i < n; i++)
+			x[i * lanes + l] = raw[i * lanes + l] * window[i];
+		omega[l] = tones[l].frequency + 0.5 / n;
+	}
+	omega[count - 1] = 1.0;
+
+	kern->batch.newton(x, n, count, 0, M_PI, omega, phase);
+	kern->batch.magnitude(raw, n, count, omega, phase, magnitude);
+
+	for (l = 0; l + 1 < count; l++) {
+		struct gha_info res = {omega[l], phase[l], magnitude[l]};
+		rv += tone_check(&res, tones + l, 1e-4, 1e-2, 1e-3) != 0;
+
+		for (i = 0; i < n; i++)
+			frame[i] = x[i * lanes + l];
+		kern->frame.newton(frame, tones[l].frequency + 0.5 / n, n, 0, M_PI, NEWTON_MAX_LOOPS, &ref);
+		for (i = 0; i < n; i++)
+			frame[i] = raw[i * lanes + l];
+		kern->frame.sine(sine, n, ref.frequency, ref.phase);
+		ref.magnitude = kern->frame.fit(frame, sine, n);
+		rv += info_check(&res, &ref, 1e-7, 1e-5, 1e-4) != 0;
+	}
+
+	/* silent lane: finite frequency, no magnitude */
+	rv += !isfinite(omega[count - 1]) || !isfinite(phase[count - 1]) || magnitude[count - 1] != 0;
+
+	free(window);
+	free(sine);
+	free(frame);
+	free(x);
+	free(raw);
+
+	return rv;
+}
+
+/*
+ * Frame parallel Newton search on noise frames of n samples against frame_newton,
+ * each lane starts from own frequency, the search does not converge within
+ * NEWTON_MAX_LOOPS for some of them. Returns number of mismatches or -1 if all
+ * lanes converged.
+ */
+static int batch_check_newton_last(const struct kernels* kern, size_t n)
+{
+	size_t t, i, l;
+	int rv = 0, unconverged = 0;
+	uint32_t seed = 5;
+	struct gha_info ref, more;
+	const size_t lanes = kern->batch.lanes();
+	double omega[16], phase[16];
+	FLOAT* x = malloc(sizeof(FLOAT) * n * lanes);
+	FLOAT* frame = malloc(sizeof(FLOAT) * n);
+
+	for (t = 0; t < 8; t++) {
+		for (i = 0; i < n; i++) {
+			seed = seed * 1664525 + 1013904223;
+			frame[i] = (double)seed / 4294967296.0 - 0.5;
+			for (l = 0; l < lanes; l++)
+				x[i * lanes + l] = frame[i];
+		}
+		for (l = 0; l < lanes; l++)
+			omega[l] = 0.3 + 0.35 * l;
+
+		kern->batch.newton(x, n, lanes, 0, M_PI, omega, phase);
+
+		for (l = 0; l < lanes; l++) {
+			kern->frame.newton(frame, 0.3 + 0.35 * l, n, 0, M_PI, NEWTON_MAX_LOOPS, &ref);
+			kern->frame.newton(frame, 0.3 + 0.35 * l, n, 0, M_PI, NEWTON_MAX_LOOPS * 4, &more);
+			unconverged += fabs(more.frequency - ref.frequency) > 1e-4;
+			rv += fabs(omega[l] - ref.frequency) > 1e-6 || fabs(remainder(phase[l] - ref.phase, 2 * M_PI)) > 1e-5;
+		}
+	}
+
+	free(frame);
+	free(x);
+
+	return unconverged ? rv : -1;
+}
+
+/*
+ * Kernels of table b against table a on the same frames of n samples:
+ * frame window, Newton search, sine, fit, energy, real fft and frame
+ * parallel Newton search and magnitude. Returns number of mismatches.
+ */
+static int kernels_check_parity(const struct kernels* a, const struct kernels* b, size_t n)
+{
+	size_t i, l;
+	int rv = 0;
+	double norm = 0, err = 0;
+	struct gha_info ra, rb;
+	struct tone tones[2] = {{0.3, 0.4, 0.7}, {1.9, 2.5, 0.2}};
+	const size_t lanes = a->batch.lanes() < b->batch.lanes() ? a->batch.lanes() : b->batch.lanes();
+	const size_t la = a->batch.lanes(), lb = b->batch.lanes();
+	double omega_a[16], omega_b[16], phase_a[16], phase_b[16], magn_a[16], magn_b[16];
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	FLOAT* window = malloc(sizeof(FLOAT) * n);
+	FLOAT* xa = malloc(sizeof(FLOAT) * n);
+	FLOAT* xb = malloc(sizeof(FLOAT) * n);
+	FLOAT* ba = calloc(n * la, sizeof(FLOAT));
+	FLOAT* bb = calloc(n * lb, sizeof(FLOAT));
+	kiss_fft_cpx* fa = malloc(sizeof(kiss_fft_cpx) * (n / 2 + 1));
+	kiss_fft_cpx* fb = malloc(sizeof(kiss_fft_cpx) * (n / 2 + 1));
+	struct fft* fft_a = a->fft.alloc(n);
+	struct fft* fft_b = b->fft.alloc(n);
+
+	tones_add(pcm, n, 1, tones, 2, 1);
+	for (i = 0; i < n; i++)
+		window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / n);
+
+	a->frame.window(pcm, window, n, xa);
+	b->frame.window(pcm, window, n, xb);
+	for (i = 0; i < n; i++)
+		rv += fabs(xa[i] - xb[i]) > 1e-6;
+
+	rv += fabs(a->pcm.energy(pcm, n) - b->pcm.energy(pcm, n)) > 1e-5 * a->pcm.energy(pcm, n);
+
+	a->frame.newton(xa, 0.302, n, 0, M_PI, NEWTON_MAX_LOOPS, &ra);
+	b->frame.newton(xb, 0.302, n, 0, M_PI, NEWTON_MAX_LOOPS, &rb);
+	rv += fabs(ra.frequency - rb.frequency) > 1e-6 || fabs(ra.phase - rb.phase) > 1e-4;
+
+	/* contraction of omega * i + phase in to fma rounds argument differently, the error grows with i */
+	a->frame.sine(xa, n, ra.frequency, ra.phase);
+	b->frame.sine(xb, n, ra.frequency, ra.phase);
+	for (i = 0; i < n; i++)
+		rv += fabs(xa[i] - xb[i]) > 1e-6 + 1e-7 * i;
+	rv += fabs(a->frame.fit(pcm, xa, n) - b->frame.fit(pcm, xa, n)) > 1e-5;
+
+	a->fft.real(fft_a, pcm, fa);
+	b->fft.real(fft_b, pcm, fb);
+	for (i = 0; i < n / 2 + 1; i++) {
+		norm = fmax(norm, hypot(fa[i].r, fa[i].i));
+		err = fmax(err, hypot(fa[i].r - fb[i].r, fa[i].i - fb[i].i));
+	}
+	rv += err > 1e-5 * norm;
+
+	/* lane l holds the same two tones with shifted frequency */
+	for (l = 0; l < lanes; l++) {
+		tones_add(ba + l, n, la, tones, 2, 1);
+		for (i = 0; i < n; i++) {
+			ba[i * la + l] *= window[i];
+			bb[i * lb + l] = ba[i * la + l];
+		}
+		omega_a[l] = omega_b[l] = tones[0].frequency + 0.002;
+		tones[0].frequency += 0.05;
+	}
+	a->batch.newton(ba, n, lanes, 0, M_PI, omega_a, phase_a);
+	b->batch.newton(bb, n, lanes, 0, M_PI, omega_b, phase_b);
+	a->batch.magnitude(ba, n, lanes, omega_a, phase_a, magn_a);
+	b->batch.magnitude(bb, n, lanes, omega_a, phase_a, magn_b);
+	for (l = 0; l < lanes; l++)
+		rv += fabs(omega_a[l] - omega_b[l]) > 1e-6 || fabs(phase_a[l] - phase_b[l]) > 1e-4 || fabs(magn_a[l] - magn_b[l]) > 1e-5;
+
+	b->fft.free(fft_b);
+	a->fft.free(fft_a);
+	free(fb);
+	free(fa);
+	free(bb);
+	free(ba);
+	free(xb);
+	free(xa);
+	free(window);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Components at bin centers are found in order of magnitude,
+ * masked bins and peaks below threshold are skipped
+ */
+static int gha_check_peaks(void)
+{
+	size_t i;
+	int rv = 0;
+	const size_t n = 1024;
+	static const size_t bin[5] = {100, 20, 300, 450, 60};
+	struct tone tones[5];
+	size_t bins[5];
+	FLOAT magnitude[5];
+	unsigned char mask[513] = {0};
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	for (i = 0; i < 5; i++) {
+		tones[i].frequency = 2 * M_PI * bin[i] / n;
+		tones[i].phase = i < 4 ? i : 0;
+		tones[i].magnitude = 0.9 - 0.2 * i;
+	}
+	tones_add(pcm, n, 1, tones, 5, 1);
+
+	if (gha_get_fft_size(ctx) != n || gha_find_peaks(pcm, 5, 0.05, NULL, bins, magnitude, ctx) != 5)
+		rv = -1;
+	for (i = 0; i < 5; i++)
+		if (bins[i] != bin[i] || fabs(magnitude[i] - tones[i].magnitude) > 0.02)
+			rv = -1;
+
+	mask[bin[0]] = 1;
+	if (gha_find_peaks(pcm, 2, 0.4, mask, bins, magnitude, ctx) != 2 || bins[0] != bin[1] || bins[1] != bin[2])
+		rv = -1;
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Strong sine and weak one in each of two frames, for fast and fields checks
+ */
+static const struct tone two_frames[2][2] = {
+	{{0.7123, 2.0, 0.6}, {2.5, 0, 0.001}},
+	{{2.0071, 5.0, 0.2}, {0.5, 0, 0.001}}
+};
+
+/*
+ * Fast estimation is close to the full one, for single frames and batch
+ */
+static int gha_check_fast(size_t n, enum gha_window type, size_t padding, FLOAT mag_tolerance)
+{
+	size_t i, f;
+	int rv = 0;
+	struct gha_info res[5], ref[4];
+	FLOAT* pcm = calloc(n * 2, sizeof(FLOAT));
+	const FLOAT* frames[2] = {pcm, pcm + n};
+	gha_ctx_t ctx = gha_create_ctx(n);
+	gha_ctx_t fast = gha_create_ctx(n);
+
+	tones_add(pcm, n, 1, two_frames[0], 2, 1);
+	tones_add(pcm + n, n, 1, two_frames[1], 2, 1);
+
+	if (gha_set_window(type, 9, ctx) || gha_set_window(type, 9, fast) || gha_set_fft_padding(padding, fast))
+		rv = -1;
+	gha_set_quality(GHA_QUALITY_FAST, fast);
+
+	for (f = 0; f < 2; f++) {
+		gha_analyze_one(frames[f], ref + f, ctx);
+		gha_analyze_one(frames[f], res + f, fast);
+	}
+	gha_analyze_batch(frames, ref + 2, 2, ctx);
+	gha_analyze_batch(frames, res + 2, 2, fast);
+
+	/* the extracted sine is removed from the frame */
+	gha_extract_one(pcm, res + 4, fast);
+	tones_add(pcm, n, 1, two_frames[0] + 1, 1, -1);
+	for (i = 0; i < n; i++) {
+		if (fabs(pcm[i]) > 0.05)
+			rv = -1;
+	}
+
+	for (f = 0; f < 4; f++) {
+		if (info_check(res + f, ref + f, 0.01 * 2 * M_PI / n, 0.03, -1) ||
+			fabs(res[f].magnitude / ref[f].magnitude - 1) > mag_tolerance)
+			rv = -1;
+	}
+
+	gha_free_ctx(fast);
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Analysis with the field mask gives the same wanted fields as the full one and
+ * zero unwanted ones, extraction ignores the mask
+ */
+static int gha_check_fields(size_t n, unsigned fields, enum gha_quality quality)
+{
+	size_t i, f;
+	int rv = 0;
+	struct gha_info res[5], ref[4];
+	FLOAT* pcm = calloc(n * 2, sizeof(FLOAT));
+	const FLOAT* frames[2] = {pcm, pcm + n};
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	tones_add(pcm, n, 1, two_frames[0], 2, 1);
+	tones_add(pcm + n, n, 1, two_frames[1], 2, 1);
+
+	gha_set_quality(quality, ctx);
+
+	for (f = 0; f < 2; f++)
+		gha_analyze_one(frames[f], ref + f, ctx);
+	gha_analyze_batch(frames, ref + 2, 2, ctx);
+
+	gha_set_fields(fields, ctx);
+
+	for (f = 0; f < 2; f++)
+		gha_analyze_one(frames[f], res + f, ctx);
+	gha_analyze_batch(frames, res + 2, 2, ctx);
+
+	for (f = 0; f < 4; f++) {
+		if (res[f].frequency != ref[f].frequency)
+			rv = -1;
+		if (res[f].phase != (fields & GHA_FIELD_PHASE ? ref[f].phase : 0))
+			rv = -1;
+		if (res[f].magnitude != (fields & GHA_FIELD_MAGNITUDE ? ref[f].magnitude : 0))
+			rv = -1;
+	}
+
+	gha_extract_one(pcm, res + 4, ctx);
+	if (res[4].magnitude != ref[0].magnitude)
+		rv = -1;
+	tones_add(pcm, n, 1, two_frames[0] + 1, 1, -1);
+	for (i = 0; i < n; i++) {
+		if (fabs(pcm[i]) > 0.05)
+			rv = -1;
+	}
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Close components with rough start for adjustment and extraction checks
+ */
+static const struct tone four_tones[4] = {{0.301, 1.0, 0.5}, {0.318, 2.0, 0.3}, {1.7, 3.0, 0.1}, {2.9, 0, 0.05}};
+
+/*
+ * gha_adjust_info from a rough start: the result of all 7 iterations with
+ * per sample sines is pinned, local adjustment (rotation, early stop) differs
+ */
+static int gha_check_adjust_pinned(void)
+{
+	size_t j;
+	int rv = 0;
+	struct gha_info res[4] = {{0.3, 1.0, 0.5}, {0.32, 2.0, 0.3}, {1.7, 3.0, 0.1}, {2.9, 0, 0.05}};
+#ifdef GHA_USE_DOUBLE_API
+	const struct gha_info ref[4] = {{0.300741475, 1.16127556, 0.509678261}, {0.316329114, 3.00567499, 0.249247792},
+		{1.7000002, 3.00147126, 0.100093072}, {2.8999799, 0.0164604288, 0.0502354499}};
+#else
+	const struct gha_info ref[4] = {{0.300741494, 1.16126895, 0.509678006}, {0.316329122, 3.00567007, 0.249248743},
+		{1.70000017, 3.00146317, 0.100093089}, {2.89997983, 0.0164254084, 0.0502355136}};
+#endif
+	FLOAT* pcm = calloc(1024, sizeof(FLOAT));
+	gha_ctx_t ctx = gha_create_ctx(1024);
+
+	tones_add(pcm, 1024, 1, four_tones, 4, 1);
+
+	if (gha_adjust_info(pcm, res, 4, ctx))
+		rv = -1;
+
+	for (j = 0; j < 4; j++) {
+		if (info_check(res + j, ref + j, 2e-6, 2e-6, 2e-6))
+			rv = -1;
+	}
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Fused extraction and adjustment gives the same components as extraction and
+ * gha_adjust_info over a copy, pcm is kept and residual is pcm without them
+ */
+static int gha_check_extract_adjusted(size_t n, size_t k, int with_residual)
+{
+	size_t i, j;
+	int rv = 0;
+	struct gha_info res[4], ref[4];
+	struct tone found[4];
+	FLOAT* pcm = calloc(n * 3, sizeof(FLOAT));
+	FLOAT* copy = pcm + n;
+	FLOAT* residual = pcm + 2 * n;
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	tones_add(pcm, n, 1, four_tones, 4, 1);
+	memcpy(copy, pcm, sizeof(FLOAT) * n);
+
+	gha_extract_many_simple(copy, ref, k, ctx);
+	memcpy(copy, pcm, sizeof(FLOAT) * n);
+	if (gha_adjust_info(copy, ref, k, ctx))
+		rv = -1;
+
+	if (gha_extract_many_adjusted(pcm, with_residual ? residual : NULL, res, k, ctx))
+		rv = -1;
+
+	for (j = 0; j < k; j++) {
+		if (info_check(res + j, ref + j, 1e-6, 1e-5, 1e-5))
+			rv = -1;
+	}
+
+	/* pcm is kept, residual and found components sum up to it */
+	tones_of_info(res, k, found);
+	if (with_residual)
+		tones_add(residual, n, 1, found, k, 1);
+	for (i = 0; i < n; i++) {
+		if (pcm[i] != copy[i])
+			rv = -1;
+		if (with_residual && fabs(residual[i] - pcm[i]) > 1e-4)
+			rv = -1;
+	}
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Close components extracted one by one are biased by each other, local adjustment
+ * brings the residual close to the global one
+ */
+static int gha_check_extract_local(size_t n, size_t neighbours, double max_ratio)
+{
+	size_t j;
+	int rv = 0;
+	double e_simple, e_global, e_local;
+	const FLOAT omega[6] = {0.301, 0.318, 1.2, 1.22, 2.0, 2.6};
+	struct tone tones[6];
+	struct gha_info res[6];
+	FLOAT* pcm = calloc(n * 3, sizeof(FLOAT));
+	FLOAT* simple = pcm + n;
+	FLOAT* local = pcm + 2 * n;
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	for (j = 0; j < 6; j++) {
+		tones[j].frequency = omega[j];
+		tones[j].phase = j;
+		tones[j].magnitude = 0.3 - 0.04 * j;
+	}
+	tones_add(pcm, n, 1, tones, 6, 1);
+	memcpy(simple, pcm, sizeof(FLOAT) * n);
+	memcpy(local, pcm, sizeof(FLOAT) * n);
+
+	gha_extract_many_simple(simple, res, 6, ctx);
+	if (gha_extract_many_adjusted(pcm, NULL, res, 6, ctx))
+		rv = -1;
+	tones_of_info(res, 6, tones);
+	tones_add(pcm, n, 1, tones, 6, -1);
+	e_global = signal_energy(pcm, n);
+
+	if (gha_extract_many_local(local, res, 6, neighbours, ctx))
+		rv = -1;
+
+	e_simple = signal_energy(simple, n);
+	e_local = signal_energy(local, n);
+
+	if (e_local > e_simple || e_local > e_global * max_ratio + 1e-9 * n)
+		rv = -1;
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Three components over white noise, returns number of components extracted
+ * with the rule or -1 if they differ from gha_extract_many_simple
+ */
+static int gha_check_extract_until(size_t n, enum gha_stop rule, FLOAT threshold)
+{
+	size_t i, j, k;
+	int rv;
+	uint32_t seed = 1;
+	const struct tone tones[3] = {{0.4, 1.0, 0.5}, {1.3, 2.0, 0.2}, {2.2, 0, 0.05}};
+	struct gha_info res[8], ref[8];
+	struct gha_stop_criterion stop = {rule, threshold};
+	FLOAT* pcm = malloc(sizeof(FLOAT) * n * 2);
+	FLOAT* copy = pcm + n;
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	for (i = 0; i < n; i++) {
+		seed = seed * 1664525 + 1013904223;
+		pcm[i] = 0.002 * ((double)seed / 4294967296.0 - 0.5);
+	}
+	tones_add(pcm, n, 1, tones, 3, 1);
+	memcpy(copy, pcm, sizeof(FLOAT) * n);
+
+	k = gha_extract_until(pcm, res, 8, &stop, ctx);
+	gha_extract_many_simple(copy, ref, k, ctx);
+
+	rv = k;
+	for (j = 0; j < k; j++) {
+		if (res[j].frequency != ref[j].frequency || res[j].magnitude != ref[j].magnitude)
+			rv = -1;
+	}
+	for (j = k; j < 8; j++) {
+		if (res[j].magnitude != 0)
+			rv = -1;
+	}
+	for (i = 0; i < n; i++) {
+		if (pcm[i] != copy[i])
+			rv = -1;
+	}
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Frames below the energy gate give no component and zeroed info, the rest is
+ * analysed as without the gate. Zero frame gives finite result without the gate.
+ */
+static int gha_check_gate(size_t n)
+{
+	size_t i, f;
+	int rv = 0;
+	const struct tone loud = {0.9, 1.0, 0.3}, quiet = {2.1, 0, 0.001};
+	struct gha_info res[6], ref[6];
+	FLOAT* pcm = calloc(n * 3, sizeof(FLOAT));
+	const FLOAT* frames[6] = {pcm, pcm + n, pcm + 2 * n, pcm + n, pcm, pcm + 2 * n};
+	int16_t* s16 = malloc(sizeof(int16_t) * n);
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	tones_add(pcm, n, 1, &loud, 1, 1);
+	tones_add(pcm + n, n, 1, &quiet, 1, 1);
+	for (i = 0; i < n; i++)
+		s16[i] = 30 * (i % 7) - 90;
+
+	if (gha_analyze_one(pcm + 2 * n, res, ctx) != 0 || res[0].frequency != res[0].frequency ||
+		res[0].phase != res[0].phase || res[0].magnitude != 0)
+		rv = -1;
+
+	for (f = 0; f < 6; f++)
+		gha_analyze_one(frames[f], ref + f, ctx);
+
+	if (gha_set_energy_gate(-1, ctx) == 0 || gha_set_energy_gate(0.01, ctx))
+		rv = -1;
+
+	gha_analyze_batch(frames, res, 6, ctx);
+	for (f = 0; f < 6; f++) {
+		const int silent = frames[f] != pcm;
+		struct gha_info one;
+		if (gha_analyze_one(frames[f], &one, ctx) != (silent ? GHA_NO_COMPONENT : 0))
+			rv = -1;
+		if (silent && (one.magnitude != 0 || res[f].magnitude != 0 || res[f].frequency != 0))
+			rv = -1;
+		if (!silent && (one.frequency != ref[f].frequency || fabs(res[f].frequency - ref[f].frequency) > 1e-5))
+			rv = -1;
+	}
+
+	/* s16 frame is about 0.002 RMS after scaling */
+	if (gha_analyze_one_s16(s16, res, ctx) != GHA_NO_COMPONENT)
+		rv = -1;
+
+	if (gha_extract_one(pcm + n, res, ctx) != GHA_NO_COMPONENT || pcm[n + 1] != (FLOAT)(0.001 * sin(2.1)))
+		rv = -1;
+
+	/* nothing is extracted from a silent frame, the residual is the frame */
+	if (gha_extract_many_adjusted(pcm + 2 * n, pcm + n, res, 2, ctx) || res[0].magnitude != 0 ||
+		res[1].magnitude != 0 || pcm[n + 1] != 0)
+		rv = -1;
+
+	/* the first component is extracted, the residual is silent */
+	gha_extract_many_simple(pcm, res, 3, ctx);
+	if (tone_check(res, &loud, -1, -1, 1e-3) || res[1].magnitude != 0 || res[2].magnitude != 0)
+		rv = -1;
+
+	gha_free_ctx(ctx);
+	free(s16);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Harmonic series of present partials with the fundamental weaker than the second
+ * harmonic, k harmonics are extracted. Returns 0 if the fundamental and all the
+ * partials are found, the rest of k is about zero and the residual is small.
+ */
+static int gha_check_harmonic(size_t n, double f0, size_t present, size_t k)
+{
+	size_t h;
+	int rv = 0;
+	struct tone tones[16];
+	struct gha_info res[16];
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	for (h = 0; h < k; h++) {
+		tones[h].frequency = (h + 1) * f0;
+		tones[h].phase = 0.5 * h + 0.3;
+		tones[h].magnitude = h < present ? (h ? 0.4 / h : 0.2) : 0;
+	}
+	tones_add(pcm, n, 1, tones, present, 1);
+
+	if (gha_extract_harmonic(pcm, res, k, ctx))
+		rv = -1;
+
+	/* frequencies above pi are not checked, they are aliased */
+	for (h = 0; h < k; h++) {
+		if (tone_check(res + h, tones + h, tones[h].frequency < M_PI ? 1e-5 : -1, -1, 1e-3))
+			rv = -1;
+	}
+
+	if (signal_energy(pcm, n) > 1e-6 * n)
+		rv = -1;
+
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Four tones: residual of subband extraction is not bigger than the one of
+ * gha_extract_many_simple, silent frame gives no component
+ */
+static int gha_check_subband_residual(size_t n, size_t bands)
+{
+	size_t i, j;
+	int rv = 0;
+	const struct tone tones[4] = {{1.7, 0, 0.5}, {0.9, 1, 0.4}, {0.3, 2, 0.3}, {0.07, 3, 0.2}};
+	struct gha_info res[4];
+	FLOAT* pcm = calloc(n * 2, sizeof(FLOAT));
+	FLOAT* simple = pcm + n;
+	gha_ctx_t ctx = gha_create_ctx(n);
+	gha_subband_t sb = gha_create_subband(n, bands);
+
+	tones_add(pcm, n, 1, tones, 4, 1);
+	memcpy(simple, pcm, sizeof(FLOAT) * n);
+
+	gha_extract_many_simple(simple, res, 4, ctx);
+	gha_extract_many_subband(pcm, res, 4, sb);
+
+	if (signal_energy(pcm, n) > signal_energy(simple, n))
+		rv = -1;
+
+	memset(pcm, 0, sizeof(FLOAT) * n);
+	gha_extract_many_subband(pcm, res, 4, sb);
+	for (j = 0; j < 4; j++) {
+		if (res[j].magnitude != 0)
+			rv = -1;
+	}
+	for (i = 0; i < n; i++) {
+		if (pcm[i] != 0)
+			rv = -1;
+	}
+
+	gha_free_subband(sb);
+	gha_free_ctx(ctx);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Partials spread over subbands are extracted in order of magnitude,
+ * returns 0 if all of them are found and the residual is small
+ */
+static int gha_check_subband(size_t n, size_t bands)
+{
+	size_t j;
+	int rv = 0;
+	const struct tone tones[6] = {{2.1, 0, 0.6}, {1.0, 1, 0.5}, {0.6, 2, 0.4}, {0.25, 3, 0.3}, {0.08, 4, 0.2}, {0.03, 5, 0.1}};
+	struct gha_info res[6];
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	gha_subband_t sb = gha_create_subband(n, bands);
+
+	if (!sb) {
+		free(pcm);
+		return -1;
+	}
+
+	tones_add(pcm, n, 1, tones, 6, 1);
+
+	gha_extract_many_subband(pcm, res, 6, sb);
+
+	for (j = 0; j < 6; j++) {
+		if (tone_check(res + j, tones + j, 1e-4, -1, 1e-2))
+			rv = -1;
+	}
+
+	if (sqrt(signal_energy(pcm, n) / n) > 0.01)
+		rv = -1;
+
+	gha_free_subband(sb);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Analyze sine given as integer PCM of given format, scale and offset,
+ * returns 0 if result matches
+ */
+static int gha_check_int(size_t n, enum pcm_format format, double scale, double offset)
+{
+	size_t i;
+	int rv = 0;
+	const struct tone tone = {0.3, 0.5, 0.7};
+	struct gha_info res;
+	FLOAT* pcm = calloc(n, sizeof(FLOAT));
+	int16_t* s16 = malloc(sizeof(int16_t) * n);
+	int32_t* s32 = malloc(sizeof(int32_t) * n);
+	uint8_t* b = malloc(3 * n);
+	gha_ctx_t ctx = gha_create_ctx(n);
+
+	tones_add(pcm, n, 1, &tone, 1, 1);
+
+	for (i = 0; i < n; i++) {
+		int32_t v = lrint(pcm[i] * scale + offset);
+		s16[i] = v;
+		s32[i] = v;
+		b[i * 3] = v;
+		b[i * 3 + 1] = v >> 8;
+		b[i * 3 + 2] = v >> 16;
+		if (format == PCM_U8)
+			b[i] = v;
+	}
+
+	switch (format) {
+	case PCM_S16:
+		gha_analyze_one_s16(s16, &res, ctx);
+		break;
+	case PCM_S24:
+		gha_analyze_one_s24(b, &res, ctx);
+		break;
+	case PCM_S32:
+		gha_analyze_one_s32(s32, &res, ctx);
+		break;
+	case PCM_U8:
+		gha_analyze_one_u8(b, &res, ctx);
+		break;
+	default:
+		rv = -1;
+	}
+
+	if (tone_check(&res, &tone, 0.001, 0.01, 0.01))
+		rv = -1;
+
+	gha_free_ctx(ctx);
+	free(b);
+	free(s32);
+	free(s16);
+	free(pcm);
+
+	return rv;
+}
+
+/*
+ * Decode single G.711 sample, window is 1
+ */
+static double pcm_decode_one(uint8_t v, enum pcm_format format)
+{
+	FLOAT window = 1.0, raw, out;
+	pcm_window(&v, format, &window, 1, &raw, &out);
+	return raw * 32768;
+}
+
+/*
+ * Feed 3 frames of 160 samples with digit '5' tones (770 and 1336 Hz) to 5 channel
+ * detector (channel 3 only), returns reported digit or 0
+ */
+static char dtmf_check_digit(double low, double high)
+{
+	size_t f, c, i;
+	char digit = 0;
+	FLOAT* buf = malloc(sizeof(FLOAT) * 160 * 5);
+	const FLOAT* frames[5];
+	struct gha_dtmf_event events[5];
+	gha_dtmf_t dtmf = gha_dtmf_create(5, 160);
+
+	for (f = 0; f < 3; f++) {
+		for (c = 0; c < 5; c++) {
+			for (i = 0; i < 160; i++) {
+				const size_t n = f * 160 + i;
+				buf[c * 160 + i] = c == 3 ? low * sin(2 * M_PI * 770 * n / 8000) + high * sin(2 * M_PI * 1336 * n / 8000 + 1) : 0;
+			}
+			frames[c] = buf + c * 160;
+		}
+		if (gha_dtmf_process(dtmf, 0, 5, frames, events) == 1 && events[0].channel == 3)
+			digit = events[0].digit;
+	}
+
+	gha_dtmf_free(dtmf);
+	free(buf);
+
+	return digit;
+}
+
+/*
+ * Feed 3 frames of digit '5' to channels beyond the 5 channel detector,
+ * returns number of reported events
+ */
+static size_t dtmf_check_range(size_t first, size_t count)
+{
+	size_t f, c, i;
+	size_t ev = 0;
+	FLOAT* buf = malloc(sizeof(FLOAT) * 160);
+	int16_t* buf16 = malloc(sizeof(int16_t) * 160);
+	const FLOAT* frames[8];
+	const int16_t* frames16[8];
+	struct gha_dtmf_event events[8];
+	gha_dtmf_t dtmf = gha_dtmf_create(5, 160);
+
+	for (f = 0; f < 3; f++) {
+		for (i = 0; i < 160; i++) {
+			const size_t n = f * 160 + i;
+			buf[i] = 0.3 * sin(2 * M_PI * 770 * n / 8000) + 0.3 * sin(2 * M_PI * 1336 * n / 8000 + 1);
+			buf16[i] = buf[i] * 32767;
+		}
+		for (c = 0; c < 8; c++) {
+			frames[c] = buf;
+			frames16[c] = buf16;
+		}
+		ev += gha_dtmf_process(dtmf, first, count, frames, events);
+		ev += gha_dtmf_process_s16(dtmf, first, count, frames16, events);
+	}
+
+	gha_dtmf_free(dtmf);
+	free(buf16);
+	free(buf);
+
+	return ev;
+}
+
 FCT_BGN()
 {
 	FCT_SUITE_BGN(simple)
@@ -39,6 +1573,282 @@ FCT_BGN()
 			free(result);
 		}
 		FCT_TEST_END();
+
+		FCT_TEST_BGN(fft_real_vs_kiss)
+		{
+			static const size_t sizes[] = {64, 128, 256, 512, 1024, 2048, 4096, 32768, 96, 1000, 202, 882, 1764, 2002,
+				7, 101, 1001, 2017};
+			size_t i;
+			for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+				fct_chk(fft_real_error(sizes[i]) < 1e-5);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(fft_cpx_vs_kiss)
+		{
+			static const size_t sizes[] = {32, 512, 4096, 48, 500, 7, 101, 1009, 2017};
+			size_t i;
+			for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+				fct_chk(fft_cpx_error(sizes[i]) < 1e-5);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_odd_size_padding)
+		{
+			fct_chk_eq_int(gha_check_sine(301, 0, 0.3, 1.0, 0.5), 0);
+			fct_chk_eq_int(gha_check_sine(301, 1, 0.3, 1.0, 0.5), 0);
+			fct_chk_eq_int(gha_check_sine(301, 4, 0.3, 1.0, 0.5), 0);
+			fct_chk_eq_int(gha_check_sine(1000, 8, 2.0, 0.5, 0.25), 0);
+			fct_chk_eq_int(gha_check_tiny(1), 0);
+			fct_chk_eq_int(gha_check_tiny(2), 0);
+			fct_chk_eq_int(gha_check_tiny(3), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_analyze_batch)
+		{
+			fct_chk_eq_int(gha_check_batch(256, 0, 9), 0);
+			fct_chk_eq_int(gha_check_batch(96, 0, 9), 0);
+			fct_chk_eq_int(gha_check_batch(96, 2, 9), 0);
+			fct_chk_eq_int(gha_check_batch(1024, 0, 3), 0);
+			fct_chk_eq_int(gha_check_batch_setting(256, 9, 0), 0);
+			fct_chk_eq_int(gha_check_batch_setting(256, 9, 1), 0);
+			fct_chk_eq_int(gha_check_batch_setting(256, 9, 2), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_analyze_interleaved)
+		{
+			fct_chk_eq_int(gha_check_interleaved(256, 2), 0);
+			fct_chk_eq_int(gha_check_interleaved(256, 6), 0);
+			fct_chk_eq_int(gha_check_interleaved(256, 16), 0);
+			fct_chk_eq_int(gha_check_interleaved(96, 8), 0);
+			fct_chk_eq_int(gha_check_interleaved(1001, 3), 0);
+			fct_chk_eq_int(gha_check_interleaved(256, 0), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_extract_many_joint)
+		{
+			fct_chk_eq_int(gha_check_joint(1024, 1), 0);
+			fct_chk_eq_int(gha_check_joint(1024, 4), 0);
+			fct_chk_eq_int(gha_check_joint(1000, 3), 0);
+			fct_chk_eq_int(gha_check_joint_empty(256), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_extract_complex)
+		{
+			fct_chk_eq_int(gha_check_complex(1024, 0, -0.7, 1.1), 0);
+			fct_chk_eq_int(gha_check_complex(1000, 0, 0.2, -2.5), 0);
+			fct_chk_eq_int(gha_check_complex(301, 2, -3.0, 0.05), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_analyze_candidates)
+		{
+			fct_chk_eq_int(gha_check_candidates(256), 0);
+			fct_chk_eq_int(gha_check_candidates(1001), 0);
+			fct_chk_eq_int(gha_check_candidates_settings(256), 0);
+			fct_chk_eq_int(gha_check_candidates_settings(1001), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_set_band)
+		{
+			/* 1 kHz in 50 Hz - 4 kHz band of 48 kHz stream, 10 kHz outside, decimated */
+			fct_chk_eq_int(gha_check_band(2048, 2 * M_PI * 1000 / 48000, 2 * M_PI * 10000 / 48000,
+				2 * M_PI * 50 / 48000, 2 * M_PI * 4000 / 48000), 0);
+			fct_chk_eq_int(gha_check_band(1000, 2 * M_PI * 3500 / 48000, 2 * M_PI * 100 / 48000,
+				2 * M_PI * 1000 / 48000, 2 * M_PI * 4000 / 48000), 0);
+			fct_chk_eq_int(gha_check_band(1024, 1.0, 0.3, 0.5, 1.5), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_set_zoom)
+		{
+			fct_chk_eq_int(gha_check_zoom(16384, 8, 0.1309), 0);
+			fct_chk_eq_int(gha_check_zoom(10000, 4, 2.5), 0);
+			fct_chk_eq_int(gha_check_zoom(65536, 16, 0.0013), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_set_refine)
+		{
+			fct_chk_eq_int(gha_check_refine(4096, GHA_REFINE_SPECTRAL, 0.1309, 1e-3), 0);
+			fct_chk_eq_int(gha_check_refine(1000, GHA_REFINE_SPECTRAL, 2.9, 1e-3), 0);
+			fct_chk_eq_int(gha_check_refine(4096, GHA_REFINE_SPECTRAL_POLISH, 0.1309, 1e-5), 0);
+			fct_chk_eq_int(gha_check_refine(999, GHA_REFINE_SPECTRAL_POLISH, 1.7, 1e-5), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_set_window)
+		{
+			gha_ctx_t ctx = gha_create_ctx(512);
+			fct_chk_eq_int(gha_check_window(2048, GHA_WINDOW_SINE, 0), 0);
+			fct_chk_eq_int(gha_check_window(2048, GHA_WINDOW_HANN, 0), 0);
+			fct_chk_eq_int(gha_check_window(1500, GHA_WINDOW_BLACKMAN_HARRIS, 0), 0);
+			fct_chk_eq_int(gha_check_window(2048, GHA_WINDOW_KAISER, 9), 0);
+			fct_chk_eq_int(gha_check_window(2001, GHA_WINDOW_DPSS, 3), 0);
+			fct_chk_eq_int(gha_set_window(GHA_WINDOW_KAISER, -1, ctx), -1);
+			fct_chk_eq_int(gha_set_window(GHA_WINDOW_DPSS, 0, ctx), -1);
+			gha_free_ctx(ctx);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_find_peaks)
+		{
+			fct_chk_eq_int(peaks_check_kernel(peaks_find), 0);
+			fct_chk_eq_int(peaks_check_kernel(kernels_select()->peaks.find), 0);
+			fct_chk_eq_int(gha_check_peaks(), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(batch_newton)
+		{
+			const struct kernels* kern = kernels_select();
+			fct_chk_eq_int(batch_check_newton(&kernels_table, 96, kernels_table.batch.lanes()), 0);
+			fct_chk_eq_int(batch_check_newton(&kernels_table, 256, 2), 0);
+			fct_chk_eq_int(batch_check_newton(kern, 96, kern->batch.lanes()), 0);
+			fct_chk_eq_int(batch_check_newton(kern, 256, kern->batch.lanes() - 1), 0);
+			fct_chk_eq_int(batch_check_newton(kern, 1000, 2), 0);
+			fct_chk_eq_int(batch_check_newton_last(&kernels_table, 16), 0);
+			fct_chk_eq_int(batch_check_newton_last(kern, 16), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(kernels_dispatch)
+		{
+			fct_chk_eq_int(kernels_check_parity(&kernels_table, kernels_select(), 1024), 0);
+			fct_chk_eq_int(kernels_check_parity(&kernels_table, kernels_select(), 1000), 0);
+#ifdef GHA_KERNELS_AVX2
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+				fct_chk_eq_int(kernels_check_parity(&kernels_table, &kernels_table_avx2, 1024), 0);
+				fct_chk_eq_int(kernels_check_parity(&kernels_table, &kernels_table_avx2, 1000), 0);
+			}
+#endif
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_set_quality)
+		{
+			fct_chk_eq_int(gha_check_fast(1024, GHA_WINDOW_SINE, 0, 0.01), 0);
+			fct_chk_eq_int(gha_check_fast(1000, GHA_WINDOW_HANN, 0, 0.01), 0);
+			fct_chk_eq_int(gha_check_fast(512, GHA_WINDOW_BLACKMAN_HARRIS, 2, 0.02), 0);
+			fct_chk_eq_int(gha_check_fast(2048, GHA_WINDOW_KAISER, 0, 0.02), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_set_fields)
+		{
+			fct_chk_eq_int(gha_check_fields(1024, GHA_FIELD_FREQUENCY, GHA_QUALITY_FULL), 0);
+			fct_chk_eq_int(gha_check_fields(1000, GHA_FIELD_FREQUENCY | GHA_FIELD_PHASE, GHA_QUALITY_FULL), 0);
+			fct_chk_eq_int(gha_check_fields(1000, GHA_FIELD_MAGNITUDE, GHA_QUALITY_FULL), 0);
+			fct_chk_eq_int(gha_check_fields(1024, GHA_FIELD_FREQUENCY, GHA_QUALITY_FAST), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_extract_many_adjusted)
+		{
+			fct_chk_eq_int(gha_check_extract_adjusted(512, 2, 1), 0);
+			fct_chk_eq_int(gha_check_extract_adjusted(500, 4, 1), 0);
+			fct_chk_eq_int(gha_check_extract_adjusted(512, 3, 0), 0);
+			fct_chk_eq_int(gha_check_adjust_pinned(), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_extract_many_local)
+		{
+			fct_chk_eq_int(gha_check_extract_local(2048, 1, 2), 0);
+			fct_chk_eq_int(gha_check_extract_local(1000, 3, 2), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_extract_until)
+		{
+			/* 0 dB is reached after the strongest component */
+			fct_chk_eq_int(gha_check_extract_until(1024, GHA_STOP_SNR, 0), 1);
+			fct_chk_eq_int(gha_check_extract_until(1024, GHA_STOP_SNR, 20), 2);
+			fct_chk_eq_int(gha_check_extract_until(1024, GHA_STOP_SNR, 40), 3);
+			/* leftover of the strongest component may be taken, noise is not */
+			fct_chk(gha_check_extract_until(1000, GHA_STOP_DROP, 0.05) >= 3);
+			fct_chk(gha_check_extract_until(1000, GHA_STOP_DROP, 0.05) <= 4);
+			fct_chk(gha_check_extract_until(1024, GHA_STOP_MDL, 0) >= 3);
+			fct_chk(gha_check_extract_until(1024, GHA_STOP_MDL, 0) <= 4);
+			fct_chk(gha_check_extract_until(4096, GHA_STOP_MDL, 0) <= 4);
+			fct_chk(gha_check_extract_until(1024, GHA_STOP_AIC, 0) >= 3);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_set_energy_gate)
+		{
+			fct_chk_eq_int(gha_check_gate(1024), 0);
+			fct_chk_eq_int(gha_check_gate(777), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_extract_harmonic)
+		{
+			fct_chk_eq_int(gha_check_harmonic(1024, 0.0613, 6, 6), 0);
+			/* extra harmonics do not turn the fundamental in to a subharmonic */
+			fct_chk_eq_int(gha_check_harmonic(1024, 0.0613, 4, 10), 0);
+			fct_chk_eq_int(gha_check_harmonic(1000, 0.2, 8, 8), 0);
+			/* harmonics 4 and 5 are above Nyquist frequency */
+			fct_chk_eq_int(gha_check_harmonic(777, 0.9, 3, 5), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_extract_many_subband)
+		{
+			fct_chk_eq_int(gha_check_subband_residual(4096, 4), 0);
+			fct_chk_eq_int(gha_check_subband_residual(2048, 3), 0);
+			fct_chk_eq_int(gha_check_subband_residual(1024, 2), 0);
+			fct_chk_eq_int(gha_check_subband(4096, 5), 0);
+			fct_chk_eq_int(gha_check_subband(3000, 3), 0);
+			fct_chk_eq_int(gha_check_subband(4096, 1), 0);
+			fct_chk(gha_create_subband(256, 4) == NULL);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_analyze_int)
+		{
+			fct_chk_eq_int(gha_check_int(1000, PCM_S16, 32768, 0), 0);
+			fct_chk_eq_int(gha_check_int(1000, PCM_S24, 1 << 23, 0), 0);
+			fct_chk_eq_int(gha_check_int(1000, PCM_S32, 2147483648.0, 0), 0);
+			fct_chk_eq_int(gha_check_int(1000, PCM_U8, 128, 128), 0);
+			fct_chk_eq_int(gha_check_int(77, PCM_S16, 32768, 0), 0);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(pcm_g711)
+		{
+			fct_chk_eq_dbl(pcm_decode_one(0xff, PCM_ULAW), 0);
+			fct_chk_eq_dbl(pcm_decode_one(0x80, PCM_ULAW), 32124);
+			fct_chk_eq_dbl(pcm_decode_one(0x00, PCM_ULAW), -32124);
+			fct_chk_eq_dbl(pcm_decode_one(0xd5, PCM_ALAW), 8);
+			fct_chk_eq_dbl(pcm_decode_one(0x55, PCM_ALAW), -8);
+			fct_chk_eq_dbl(pcm_decode_one(0xaa, PCM_ALAW), 32256);
+			fct_chk_eq_dbl(pcm_decode_one(0x2a, PCM_ALAW), -32256);
+		}
+		FCT_TEST_END();
+
+		FCT_TEST_BGN(gha_dtmf)
+		{
+			fct_chk_eq_int(dtmf_check_digit(0.3, 0.3), '5');
+			fct_chk_eq_int(dtmf_check_digit(0.3, 0.2), '5');
+			/* twist: 12 dB normal, 12 dB reverse */
+			fct_chk_eq_int(dtmf_check_digit(0.1, 0.4), 0);
+			fct_chk_eq_int(dtmf_check_digit(0.4, 0.1), 0);
+			/* single tone */
+			fct_chk_eq_int(dtmf_check_digit(0.3, 0), 0);
+			/* channels out of range */
+			fct_chk_eq_int(dtmf_check_range(3, 3), 0);
+			fct_chk_eq_int(dtmf_check_range(6, 1), 0);
+			fct_chk_eq_int(dtmf_check_range((size_t)-1, 2), 0);
+			fct_chk_eq_int(dtmf_check_range(3, 2) > 0, 1);
+		}
+		FCT_TEST_END();
 	}
 	FCT_SUITE_END();
 }